@@ -0,0 +1,376 @@
+//  Benchmark of the neighborhood filters found in the examples.
+//
+//  A synthetic float image is generated in memory for each requested size
+//  (about one pixel in ten is zero, to exercise the no-data handling of the
+//  mean filters), and every implementation is run on it for each requested
+//  radius and number of threads.  One JSON object is printed per run on the
+//  standard output, so the results can be loaded directly with any JSON lines
+//  reader:
+//
+//    {"filter": "CustomFilter/integral", "size": 4096, "radius": 3,
+//     "threads": 8, "seconds": 0.21, "mpixels_per_s": 79.9,
+//     "peak_rss_mib": 192.4, "scaling_efficiency": 0.93}
+//
+//  The scaling efficiency is the speedup over the smallest thread count of
+//  the list, divided by the ratio of thread counts.  Implementations that do
+//  not use the multi-threader (the neighborhood iterator loops of
+//  MeanFilterExample and NeighborhoodIteratorsMean) are only run once, with
+//  the smallest thread count.  The peak resident set size is reset before
+//  each run through /proc/self/clear_refs, so it covers the input image plus
+//  whatever the run allocates.
+
+#include "itkConstNeighborhoodIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMultiThreaderBase.h"
+#include "itkVarianceImageFilter.h"
+#include "otbImage.h"
+#include "otbLocalStatisticExtractionFilter.h"
+#include "otbVectorImage.h"
+
+#include "CustomFilter.h"
+#include "MaskedLocalStatisticsImageFilter.h"
+#include "MeanFilterExample.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using PixelType = float;
+using ImageType = otb::Image<PixelType, 2>;
+using VectorImageType = otb::VectorImage<PixelType, 2>;
+using Clock = std::chrono::steady_clock;
+
+struct Implementation {
+  std::string name;
+  // False when the implementation ignores the number of threads
+  bool threaded;
+  // Runs the implementation once and returns the elapsed time in seconds
+  std::function<double(ImageType *, unsigned int, unsigned int)> run;
+};
+
+std::vector<unsigned int> ParseList(const std::string &text) {
+  std::vector<unsigned int> values;
+  std::stringstream stream(text);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      values.push_back(std::stoi(item));
+    }
+  }
+  return values;
+}
+
+void ResetPeakRSS() {
+  // Writing 5 resets VmHWM to the current resident set size (Linux >= 4.0)
+  std::ofstream clearRefs("/proc/self/clear_refs");
+  clearRefs << "5";
+}
+
+double PeakRSSMiB() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::stod(line.substr(6)) / 1024.0;
+    }
+  }
+  return 0.0;
+}
+
+ImageType::Pointer MakeSyntheticImage(unsigned int size) {
+  ImageType::IndexType start;
+  start.Fill(0);
+  ImageType::SizeType imageSize;
+  imageSize.Fill(size);
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(ImageType::RegionType(start, imageSize));
+  image->Allocate();
+
+  std::mt19937 generator(size);
+  std::uniform_real_distribution<PixelType> value(1.0f, 1000.0f);
+  std::bernoulli_distribution noData(0.1);
+
+  itk::ImageRegionIterator<ImageType> it(image,
+                                         image->GetLargestPossibleRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it) {
+    it.Set(noData(generator) ? 0.0f : value(generator));
+  }
+  return image;
+}
+
+double Seconds(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//  Run a pipeline filter on the in-memory image, limiting its multi-threader
+//  to the given number of threads.
+
+template <class TFilter>
+double RunFilter(TFilter *filter, ImageType *input, unsigned int threads) {
+  filter->SetInput(input);
+  filter->GetMultiThreader()->SetMaximumNumberOfThreads(threads);
+  filter->SetNumberOfWorkUnits(threads);
+
+  const Clock::time_point start = Clock::now();
+  filter->Update();
+  return Seconds(start);
+}
+
+//  The loop of NeighborhoodIteratorsMean, which is written directly in its
+//  main() rather than as a filter.
+
+double RunNeighborhoodIteratorsMean(ImageType *input, unsigned int radius) {
+  using NeighborhoodIteratorType = itk::ConstNeighborhoodIterator<ImageType>;
+  using IteratorType = itk::ImageRegionIterator<ImageType>;
+
+  const Clock::time_point start = Clock::now();
+
+  NeighborhoodIteratorType::RadiusType neighborhoodRadius;
+  neighborhoodRadius.Fill(radius);
+  NeighborhoodIteratorType it(neighborhoodRadius, input,
+                              input->GetRequestedRegion());
+
+  ImageType::Pointer output = ImageType::New();
+  output->SetRegions(input->GetRequestedRegion());
+  output->Allocate();
+
+  IteratorType out(output, input->GetRequestedRegion());
+
+  for (it.GoToBegin(), out.GoToBegin(); !it.IsAtEnd(); ++it, ++out) {
+    float sum = 0.0;
+    unsigned int count = 0;
+
+    for (unsigned int i = 0; i < it.Size(); ++i) {
+      if (it.GetPixel(i) != itk::NumericTraits<PixelType>::Zero) {
+        sum += it.GetPixel(i);
+        ++count;
+      }
+    }
+    if (count > 0) {
+      out.Set(sum / count);
+    } else {
+      out.Set(0.0);
+    }
+  }
+
+  return Seconds(start);
+}
+
+std::vector<Implementation> MakeImplementations() {
+  std::vector<Implementation> implementations;
+
+  // examples_03/filters/CustomFilterExample, in its three modes
+  const char *customModes[] = {"brute", "integral", "kahan"};
+  for (const std::string mode : customModes) {
+    implementations.push_back(
+        {"CustomFilter/" + mode, true,
+         [mode](ImageType *input, unsigned int radius, unsigned int threads) {
+           CustomFilter<ImageType>::Pointer filter =
+               CustomFilter<ImageType>::New();
+           filter->SetRadius(radius);
+           filter->SetUseIntegralImage(mode != "brute");
+           filter->SetUseKahanSummation(mode == "kahan");
+           return RunFilter(filter.GetPointer(), input, threads);
+         }});
+  }
+
+  // otb_examples/filters/MeanFilterExample
+  implementations.push_back(
+      {"MeanFilterExample", false,
+       [](ImageType *input, unsigned int radius, unsigned int threads) {
+         otb::MeanFilterExample<ImageType>::Pointer filter =
+             otb::MeanFilterExample<ImageType>::New();
+         filter->SetRadius(radius);
+         return RunFilter(filter.GetPointer(), input, threads);
+       }});
+
+  // otb_examples/iterators/NeighborhoodIteratorsMean
+  implementations.push_back(
+      {"NeighborhoodIteratorsMean", false,
+       [](ImageType *input, unsigned int radius, unsigned int) {
+         return RunNeighborhoodIteratorsMean(input, radius);
+       }});
+
+  // otb_examples/iterators/NeighborhoodIteratorsVariance
+  implementations.push_back(
+      {"MaskedLocalStatisticsImageFilter", true,
+       [](ImageType *input, unsigned int radius, unsigned int threads) {
+         using FilterType =
+             otb::MaskedLocalStatisticsImageFilter<ImageType, VectorImageType>;
+         FilterType::Pointer filter = FilterType::New();
+         filter->SetRadius(radius);
+         return RunFilter(filter.GetPointer(), input, threads);
+       }});
+
+  // variance/VarianceFilter
+  implementations.push_back(
+      {"LocalStatisticExtractionFilter", true,
+       [](ImageType *input, unsigned int radius, unsigned int threads) {
+         using FilterType =
+             otb::LocalStatisticExtractionFilter<ImageType, ImageType>;
+         FilterType::Pointer filter = FilterType::New();
+         filter->SetRadius(radius);
+         filter->SetComputeVariance(true);
+         return RunFilter(filter.GetPointer(), input, threads);
+       }});
+
+  // variance/SARVarianceFilter
+  implementations.push_back(
+      {"VarianceImageFilter", true,
+       [](ImageType *input, unsigned int radius, unsigned int threads) {
+         using FilterType = itk::VarianceImageFilter<ImageType, ImageType>;
+         FilterType::Pointer filter = FilterType::New();
+         FilterType::InputSizeType filterRadius;
+         filterRadius.Fill(radius);
+         filter->SetRadius(filterRadius);
+         return RunFilter(filter.GetPointer(), input, threads);
+       }});
+
+  return implementations;
+}
+
+void Usage(const char *program) {
+  std::cerr << "Usage: " << program << " [options]" << std::endl;
+  std::cerr << "  --sizes s1,s2,...    image side lengths "
+               "(default 1024,2048,4096,8192,16384)"
+            << std::endl;
+  std::cerr << "  --radii r1,r2,...    window radii (default 1,2,3,5,7,10,15)"
+            << std::endl;
+  std::cerr << "  --threads t1,t2,...  thread counts (default 1,2,4,... up to "
+               "the number of cores)"
+            << std::endl;
+  std::cerr << "  --filters name,...   only run the named implementations"
+            << std::endl;
+  std::cerr << "  --repeat n           keep the best of n runs (default 1)"
+            << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::vector<unsigned int> sizes = {1024, 2048, 4096, 8192, 16384};
+  std::vector<unsigned int> radii = {1, 2, 3, 5, 7, 10, 15};
+  std::vector<unsigned int> threads;
+  std::vector<std::string> selected;
+  unsigned int repeat = 1;
+
+  const unsigned int cores =
+      itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  for (unsigned int t = 1; t < cores; t *= 2) {
+    threads.push_back(t);
+  }
+  threads.push_back(cores);
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string option = argv[i];
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    const std::string value = argv[++i];
+    if (option == "--sizes") {
+      sizes = ParseList(value);
+    } else if (option == "--radii") {
+      radii = ParseList(value);
+    } else if (option == "--threads") {
+      threads = ParseList(value);
+    } else if (option == "--filters") {
+      std::stringstream stream(value);
+      std::string name;
+      while (std::getline(stream, name, ',')) {
+        selected.push_back(name);
+      }
+    } else if (option == "--repeat") {
+      repeat = std::max(1, std::stoi(value));
+    } else {
+      Usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The efficiency is measured against the smallest thread count
+  std::sort(threads.begin(), threads.end());
+  threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+  if (sizes.empty() || radii.empty() || threads.empty() || threads[0] == 0) {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::vector<Implementation> implementations = MakeImplementations();
+  if (!selected.empty()) {
+    implementations.erase(
+        std::remove_if(implementations.begin(), implementations.end(),
+                       [&](const Implementation &implementation) {
+                         return std::find(selected.begin(), selected.end(),
+                                          implementation.name) ==
+                                selected.end();
+                       }),
+        implementations.end());
+  }
+
+  try {
+    for (unsigned int size : sizes) {
+      std::cerr << "Generating " << size << "x" << size << " image"
+                << std::endl;
+      ImageType::Pointer input = MakeSyntheticImage(size);
+      const double mpixels = static_cast<double>(size) * size / 1e6;
+
+      for (const Implementation &implementation : implementations) {
+        for (unsigned int radius : radii) {
+          double baseThroughput = 0.0;
+
+          for (unsigned int threadCount : threads) {
+            if (!implementation.threaded && threadCount != threads[0]) {
+              break;
+            }
+
+            std::cerr << implementation.name << " size=" << size
+                      << " radius=" << radius << " threads=" << threadCount
+                      << std::endl;
+
+            ResetPeakRSS();
+            double best = 0.0;
+            for (unsigned int r = 0; r < repeat; ++r) {
+              const double seconds =
+                  implementation.run(input, radius, threadCount);
+              best = (r == 0) ? seconds : std::min(best, seconds);
+            }
+            const double peakRSS = PeakRSSMiB();
+
+            const double throughput = mpixels / best;
+            if (threadCount == threads[0]) {
+              baseThroughput = throughput;
+            }
+            const double efficiency = (throughput / baseThroughput) *
+                                      threads[0] /
+                                      static_cast<double>(threadCount);
+
+            std::cout << "{\"filter\": \"" << implementation.name
+                      << "\", \"size\": " << size << ", \"radius\": " << radius
+                      << ", \"threads\": " << threadCount
+                      << ", \"seconds\": " << best
+                      << ", \"mpixels_per_s\": " << throughput
+                      << ", \"peak_rss_mib\": " << peakRSS
+                      << ", \"scaling_efficiency\": " << efficiency << "}"
+                      << std::endl;
+          }
+        }
+      }
+    }
+  } catch (itk::ExceptionObject &err) {
+    std::cerr << "ExceptionObject caught !" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,389 @@
+//  Benchmark of the float and double compute paths of the example pipelines.
+//
+//  ScalingPipeline, LeeImageFilter and BandMathFilterExample take a
+//  \code{--precision f32|f64} option.  This benchmark runs their filters
+//  (the tiled Canny edge detection, the integral Lee filter and the NDVI
+//  threshold of the band math example) in both precisions on each scene,
+//  loaded once in memory, and compares the float results with the double
+//  ones.  One JSON object is printed per run on the standard output:
+//
+//    {"pipeline": "Lee", "scene": "spot.tif", "precision": "f32",
+//     "seconds": 0.41, "mpixels_per_s": 97.3, "peak_rss_mib": 612.0,
+//     "max_abs_error": 0.0021, "rms_error": 0.0003, "mismatch_fraction": 0.02}
+//
+//  The errors are those of the f32 output against the f64 one (0 for the
+//  f64 runs), and the mismatch fraction is the fraction of pixels whose
+//  values differ at all, which is the relevant figure for the binary edge
+//  and threshold outputs.  The single-band filters run on the first band
+//  of the scene, and the band math only on scenes of 4 bands or more.
+//  Without \code{--scenes}, a synthetic 4-band scene of 12-bit values is
+//  generated for each of the \code{--sizes}.
+
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMultiThreaderBase.h"
+#include "otbImage.h"
+#include "otbImageFileReader.h"
+#include "otbVectorImage.h"
+
+#include "IntegralLeeImageFilter.h"
+#include "TiledCannyEdgeDetectionImageFilter.h"
+#include "VectorBandMathImageFilter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+using SceneType = otb::VectorImage<double, 2>;
+using Clock = std::chrono::steady_clock;
+
+//  Result of one run: its time, and its output as doubles for the
+//  comparison between precisions.
+
+struct RunResult {
+  double seconds;
+  std::vector<double> output;
+};
+
+struct Pipeline {
+  std::string name;
+  // Smallest number of bands of the scene the pipeline runs on
+  unsigned int minimumBands;
+  std::function<RunResult(SceneType *, unsigned int)> runFloat;
+  std::function<RunResult(SceneType *, unsigned int)> runDouble;
+};
+
+std::vector<std::string> ParseNames(const std::string &text) {
+  std::vector<std::string> names;
+  std::stringstream stream(text);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      names.push_back(item);
+    }
+  }
+  return names;
+}
+
+void ResetPeakRSS() {
+  // Writing 5 resets VmHWM to the current resident set size (Linux >= 4.0)
+  std::ofstream clearRefs("/proc/self/clear_refs");
+  clearRefs << "5";
+}
+
+double PeakRSSMiB() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::stod(line.substr(6)) / 1024.0;
+    }
+  }
+  return 0.0;
+}
+
+double Seconds(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//  Smooth structures plus noise, rounded to integers like the 12-bit
+//  scenes the examples process; the bands are scaled differently so the
+//  NDVI is not constant.
+
+SceneType::Pointer MakeSyntheticScene(unsigned int size) {
+  const unsigned int nbBands = 4;
+  SceneType::IndexType start;
+  start.Fill(0);
+  SceneType::SizeType sceneSize;
+  sceneSize.Fill(size);
+
+  SceneType::Pointer scene = SceneType::New();
+  scene->SetRegions(SceneType::RegionType(start, sceneSize));
+  scene->SetNumberOfComponentsPerPixel(nbBands);
+  scene->Allocate();
+
+  std::mt19937 generator(size);
+  std::normal_distribution<double> noise(0.0, 20.0);
+
+  double *buffer = scene->GetBufferPointer();
+  for (unsigned int y = 0; y < size; ++y) {
+    for (unsigned int x = 0; x < size; ++x) {
+      const double base =
+          2000.0 + 1000.0 * std::sin(x / 37.0) * std::cos(y / 53.0) +
+          ((x / 128 + y / 128) % 2 ? 500.0 : 0.0);
+      for (unsigned int b = 0; b < nbBands; ++b) {
+        const double value = base * (1.0 + 0.1 * b) + noise(generator);
+        *buffer++ = std::min(std::max(std::round(value), 1.0), 4095.0);
+      }
+    }
+  }
+  return scene;
+}
+
+SceneType::Pointer ReadScene(const std::string &fileName) {
+  using ReaderType = otb::ImageFileReader<SceneType>;
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(fileName);
+  reader->Update();
+  SceneType::Pointer scene = reader->GetOutput();
+  scene->DisconnectPipeline();
+  return scene;
+}
+
+//  Copies of the scene in the precision of the run, made before the timer
+//  starts: the first band as a scalar image, or all the bands.
+
+template <class TImage>
+typename TImage::Pointer ExtractFirstBand(const SceneType *scene) {
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions(scene->GetLargestPossibleRegion());
+  image->Allocate();
+
+  const unsigned int nbBands = scene->GetNumberOfComponentsPerPixel();
+  const double *input = scene->GetBufferPointer();
+  typename TImage::PixelType *output = image->GetBufferPointer();
+  const size_t nbPixels =
+      scene->GetLargestPossibleRegion().GetNumberOfPixels();
+  for (size_t i = 0; i < nbPixels; ++i) {
+    output[i] = static_cast<typename TImage::PixelType>(input[i * nbBands]);
+  }
+  return image;
+}
+
+template <class TImage>
+typename TImage::Pointer ConvertScene(const SceneType *scene) {
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions(scene->GetLargestPossibleRegion());
+  image->SetNumberOfComponentsPerPixel(
+      scene->GetNumberOfComponentsPerPixel());
+  image->Allocate();
+
+  const size_t nbValues =
+      scene->GetLargestPossibleRegion().GetNumberOfPixels() *
+      scene->GetNumberOfComponentsPerPixel();
+  std::transform(scene->GetBufferPointer(),
+                 scene->GetBufferPointer() + nbValues,
+                 image->GetBufferPointer(), [](double value) {
+                   return static_cast<typename TImage::InternalPixelType>(
+                       value);
+                 });
+  return image;
+}
+
+template <class TImage> std::vector<double> ToDoubles(const TImage *image) {
+  const typename TImage::PixelType *buffer = image->GetBufferPointer();
+  return std::vector<double>(
+      buffer,
+      buffer + image->GetLargestPossibleRegion().GetNumberOfPixels());
+}
+
+template <class TFilter>
+RunResult RunFilter(TFilter *filter, unsigned int threads) {
+  filter->GetMultiThreader()->SetMaximumNumberOfThreads(threads);
+  filter->SetNumberOfWorkUnits(threads);
+
+  const Clock::time_point start = Clock::now();
+  filter->Update();
+  const double seconds = Seconds(start);
+  return {seconds, ToDoubles(filter->GetOutput())};
+}
+
+template <class TReal>
+RunResult RunCanny(SceneType *scene, unsigned int threads) {
+  using ImageType = otb::Image<TReal, 2>;
+  using FilterType =
+      otb::TiledCannyEdgeDetectionImageFilter<ImageType, ImageType>;
+
+  typename ImageType::Pointer input = ExtractFirstBand<ImageType>(scene);
+  typename FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(input);
+  return RunFilter(filter.GetPointer(), threads);
+}
+
+template <class TReal>
+RunResult RunLee(SceneType *scene, unsigned int threads) {
+  using ImageType = otb::Image<TReal, 2>;
+  using FilterType = otb::IntegralLeeImageFilter<ImageType, ImageType>;
+
+  typename ImageType::Pointer input = ExtractFirstBand<ImageType>(scene);
+  typename FilterType::Pointer filter = FilterType::New();
+  typename FilterType::SizeType radius;
+  radius.Fill(3);
+  filter->SetRadius(radius);
+  filter->SetNbLooks(1);
+  filter->SetInput(input);
+  return RunFilter(filter.GetPointer(), threads);
+}
+
+template <class TReal>
+RunResult RunBandMath(SceneType *scene, unsigned int threads) {
+  using InputImageType = otb::VectorImage<TReal, 2>;
+  using OutputImageType = otb::Image<TReal, 2>;
+  using FilterType =
+      otb::VectorBandMathImageFilter<InputImageType, OutputImageType>;
+
+  typename InputImageType::Pointer input = ConvertScene<InputImageType>(scene);
+  typename FilterType::Pointer filter = FilterType::New();
+  filter->SetExpression("if((b4-b3)/(b4+b3) > 0.4, 255, 0)");
+  filter->SetSinglePrecision(std::is_same<TReal, float>::value);
+  filter->SetInput(input);
+  return RunFilter(filter.GetPointer(), threads);
+}
+
+std::vector<Pipeline> MakePipelines() {
+  return {{"Canny", 1, RunCanny<float>, RunCanny<double>},
+          {"Lee", 1, RunLee<float>, RunLee<double>},
+          {"BandMath", 4, RunBandMath<float>, RunBandMath<double>}};
+}
+
+void PrintResult(const std::string &pipeline, const std::string &scene,
+                 const char *precision, double seconds, double mpixels,
+                 double peakRSS, const std::vector<double> &output,
+                 const std::vector<double> &reference) {
+  double maxError = 0.0;
+  double squaredError = 0.0;
+  size_t mismatches = 0;
+  for (size_t i = 0; i < output.size(); ++i) {
+    const double error = std::abs(output[i] - reference[i]);
+    maxError = std::max(maxError, error);
+    squaredError += error * error;
+    mismatches += output[i] != reference[i];
+  }
+  const double count = std::max<size_t>(output.size(), 1);
+
+  std::cout << "{\"pipeline\": \"" << pipeline << "\", \"scene\": \"" << scene
+            << "\", \"precision\": \"" << precision
+            << "\", \"seconds\": " << seconds
+            << ", \"mpixels_per_s\": " << mpixels / seconds
+            << ", \"peak_rss_mib\": " << peakRSS
+            << ", \"max_abs_error\": " << maxError
+            << ", \"rms_error\": " << std::sqrt(squaredError / count)
+            << ", \"mismatch_fraction\": " << mismatches / count << "}"
+            << std::endl;
+}
+
+void Usage(const char *program) {
+  std::cerr << "Usage: " << program << " [options]" << std::endl;
+  std::cerr << "  --scenes f1,f2,...   reference scenes (default: synthetic)"
+            << std::endl;
+  std::cerr << "  --sizes s1,s2,...    synthetic scene side lengths "
+               "(default 2048,8192)"
+            << std::endl;
+  std::cerr << "  --threads n          number of threads (default: all cores)"
+            << std::endl;
+  std::cerr << "  --pipelines name,... only run the named pipelines "
+               "(Canny, Lee, BandMath)"
+            << std::endl;
+  std::cerr << "  --repeat n           keep the best of n runs (default 1)"
+            << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::vector<std::string> scenes;
+  std::vector<std::string> sizes = {"2048", "8192"};
+  std::vector<std::string> selected;
+  unsigned int threads =
+      itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  unsigned int repeat = 1;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string option = argv[i];
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    const std::string value = argv[++i];
+    if (option == "--scenes") {
+      scenes = ParseNames(value);
+    } else if (option == "--sizes") {
+      sizes = ParseNames(value);
+    } else if (option == "--threads") {
+      threads = std::max(1, std::stoi(value));
+    } else if (option == "--pipelines") {
+      selected = ParseNames(value);
+    } else if (option == "--repeat") {
+      repeat = std::max(1, std::stoi(value));
+    } else {
+      Usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<Pipeline> pipelines = MakePipelines();
+  if (!selected.empty()) {
+    pipelines.erase(std::remove_if(pipelines.begin(), pipelines.end(),
+                                   [&](const Pipeline &pipeline) {
+                                     return std::find(selected.begin(),
+                                                      selected.end(),
+                                                      pipeline.name) ==
+                                            selected.end();
+                                   }),
+                    pipelines.end());
+  }
+
+  try {
+    const std::vector<std::string> &sources = scenes.empty() ? sizes : scenes;
+    for (const std::string &source : sources) {
+      std::cerr << "Loading " << source << std::endl;
+      SceneType::Pointer scene = scenes.empty()
+                                     ? MakeSyntheticScene(std::stoi(source))
+                                     : ReadScene(source);
+      const std::string sceneName =
+          scenes.empty() ? "synthetic-" + source : source;
+      const double mpixels =
+          scene->GetLargestPossibleRegion().GetNumberOfPixels() / 1e6;
+
+      for (const Pipeline &pipeline : pipelines) {
+        if (scene->GetNumberOfComponentsPerPixel() < pipeline.minimumBands) {
+          std::cerr << "Skipping " << pipeline.name << " on " << sceneName
+                    << ": " << pipeline.minimumBands << " bands needed"
+                    << std::endl;
+          continue;
+        }
+
+        // The double run first: it is the reference of the float one
+        std::vector<double> reference;
+        for (const char *precision : {"f64", "f32"}) {
+          std::cerr << pipeline.name << " scene=" << sceneName
+                    << " precision=" << precision << std::endl;
+          const bool isFloat = std::string(precision) == "f32";
+
+          ResetPeakRSS();
+          RunResult best;
+          for (unsigned int r = 0; r < repeat; ++r) {
+            RunResult result = isFloat ? pipeline.runFloat(scene, threads)
+                                       : pipeline.runDouble(scene, threads);
+            if (r == 0 || result.seconds < best.seconds) {
+              best = std::move(result);
+            }
+          }
+          const double peakRSS = PeakRSSMiB();
+
+          if (!isFloat) {
+            reference = best.output;
+          }
+          PrintResult(pipeline.name, sceneName, precision, best.seconds,
+                      mpixels, peakRSS, best.output, reference);
+        }
+      }
+    }
+  } catch (itk::ExceptionObject &err) {
+    std::cerr << "ExceptionObject caught !" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+//  Runtime choice of the floating-point type of the example pipelines.
+//
+//  The examples used to fix their pixel type to \code{double}, although
+//  their inputs are 8 or 16 bit scenes: every intermediate image then takes
+//  twice the memory and bandwidth of a \code{float} one, and vector loops
+//  process half as many pixels per instruction.  \code{--precision f32} or
+//  \code{--precision f64} on the command line selects the type; like
+//  \code{--trace} for the \code{PipelineProfiler}, both arguments are
+//  removed from \code{argv}.  The default stays \code{f64}, the former
+//  behavior.  The examples are written as a \code{Run<TReal>()} template
+//  instantiated for both types:
+//
+//  \begin{verbatim}
+//  int main(int argc, char *argv[]) {
+//    otb::ComputePrecision precision;
+//    if (!otb::ParseComputePrecision(argc, argv, precision)) {
+//      return EXIT_FAILURE;
+//    }
+//    return precision == otb::ComputePrecision::Float32
+//               ? Run<float>(argc, argv)
+//               : Run<double>(argc, argv);
+//  }
+//  \end{verbatim}
+//
+//  Only the images follow the precision: reductions over many pixels (sums,
+//  summed-area tables, statistics) keep accumulating in \code{double}.
+
+#ifndef ComputePrecision_h
+#define ComputePrecision_h
+
+#include <iostream>
+#include <string>
+
+namespace otb {
+
+enum class ComputePrecision { Float32, Float64 };
+
+/** Name of the precision on the command line */
+inline const char *ComputePrecisionName(ComputePrecision precision) {
+  return precision == ComputePrecision::Float32 ? "f32" : "f64";
+}
+
+/** Take --precision f32|f64 out of the arguments; false, with a message, if
+ * the value is not one of those */
+inline bool ParseComputePrecision(int &argc, char *argv[],
+                                  ComputePrecision &precision) {
+  precision = ComputePrecision::Float64;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) != "--precision" || i + 1 >= argc) {
+      continue;
+    }
+    const std::string value = argv[i + 1];
+    if (value == "f32") {
+      precision = ComputePrecision::Float32;
+    } else if (value != "f64") {
+      std::cerr << "Unknown precision " << value << " (f32 or f64)"
+                << std::endl;
+      return false;
+    }
+    for (int j = i + 2; j <= argc; ++j) {
+      argv[j - 2] = argv[j];
+    }
+    argc -= 2;
+    break;
+  }
+  return true;
+}
+
+} // namespace otb
+
+#endif
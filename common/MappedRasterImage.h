@@ -0,0 +1,228 @@
+//  Fast paths for the programs that copy or convert a raster.
+//
+//  \doxygen{otb}{ImageFileReader} decodes the file into a buffer of its own,
+//  which \doxygen{otb}{ImageFileWriter} then encodes again: every pixel is
+//  copied at least twice even when nothing is done to it.  This header
+//  offers two shortcuts, both of which report when they do not apply so the
+//  caller can fall back to the usual reader.
+//
+//  \code{MappedRasterImage} exposes the pages of an uncompressed raster
+//  (raw, ENVI, or a striped uncompressed GeoTIFF) directly as the buffer of
+//  an image, through GDAL's memory mapping of the file.  This is only
+//  possible when the file layout is the image layout: a single band whose
+//  pixel type is the image pixel type, in native byte order, with rows
+//  stored contiguously one after the other.  The pages are read on demand by
+//  the kernel and the image is read-only.
+//
+//  \code{CopyRasterFiles} handles a copy between two files of the same
+//  format, when the bands already hold the type the program would write: the
+//  output would then be the input, so the files of the dataset are copied as
+//  they are, without decoding a single tile.
+
+#ifndef MappedRasterImage_h
+#define MappedRasterImage_h
+
+#include "itkIntTypes.h"
+
+#include "cpl_virtualmem.h"
+#include "gdal.h"
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <type_traits>
+
+namespace otb {
+
+/** GDAL data type of a C++ pixel value type, GDT_Unknown if there is none */
+template <class TValue> GDALDataType GetGDALDataType() {
+  if (std::is_same<TValue, unsigned char>::value) {
+    return GDT_Byte;
+  }
+  if (std::is_same<TValue, unsigned short>::value) {
+    return GDT_UInt16;
+  }
+  if (std::is_same<TValue, short>::value) {
+    return GDT_Int16;
+  }
+  if (std::is_same<TValue, unsigned int>::value) {
+    return GDT_UInt32;
+  }
+  if (std::is_same<TValue, int>::value) {
+    return GDT_Int32;
+  }
+  if (std::is_same<TValue, float>::value) {
+    return GDT_Float32;
+  }
+  if (std::is_same<TValue, double>::value) {
+    return GDT_Float64;
+  }
+  return GDT_Unknown;
+}
+
+template <class TImage> class MappedRasterImage {
+public:
+  using ImageType = TImage;
+  using ImagePointer = typename TImage::Pointer;
+  using InternalPixelType = typename TImage::InternalPixelType;
+
+  /** Try to map the given file; IsMapped() tells whether it succeeded */
+  explicit MappedRasterImage(const std::string &fileName)
+      : m_Dataset(nullptr), m_Memory(nullptr) {
+    // Extended filenames select bands, boxes or decimations: not a mapping
+    if (fileName.find('?') != std::string::npos) {
+      return;
+    }
+
+    GDALAllRegister();
+    m_Dataset = GDALOpen(fileName.c_str(), GA_ReadOnly);
+    if (!m_Dataset || GDALGetRasterCount(m_Dataset) != 1) {
+      return;
+    }
+
+    GDALRasterBandH band = GDALGetRasterBand(m_Dataset, 1);
+    const GDALDataType dataType = GDALGetRasterDataType(band);
+    if (dataType == GDT_Unknown ||
+        dataType != GetGDALDataType<InternalPixelType>()) {
+      return;
+    }
+
+    // Rotated or sheared rasters cannot be described by origin and spacing
+    double transform[6] = {0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+    GDALGetGeoTransform(m_Dataset, transform);
+    if (transform[2] != 0.0 || transform[4] != 0.0) {
+      return;
+    }
+
+    // Only an actual mapping of the file is accepted, not GDAL's emulation
+    // through its block cache
+    const char *options[] = {"USE_DEFAULT_IMPLEMENTATION=NO", nullptr};
+    int pixelSpace = 0;
+    GIntBig lineSpace = 0;
+    m_Memory = GDALGetVirtualMemAuto(band, GF_Read, &pixelSpace, &lineSpace,
+                                     const_cast<char **>(options));
+    if (!m_Memory) {
+      return;
+    }
+
+    const long width = GDALGetRasterXSize(m_Dataset);
+    const long height = GDALGetRasterYSize(m_Dataset);
+    if (pixelSpace != static_cast<int>(sizeof(InternalPixelType)) ||
+        lineSpace != static_cast<GIntBig>(width * sizeof(InternalPixelType))) {
+      this->Release();
+      return;
+    }
+
+    typename TImage::RegionType region;
+    region.SetIndex({{0, 0}});
+    region.SetSize({{static_cast<itk::SizeValueType>(width),
+                     static_cast<itk::SizeValueType>(height)}});
+
+    // Same convention as the GDAL image IO: the origin is the center of the
+    // first pixel
+    typename TImage::PointType origin;
+    origin[0] = transform[0] + 0.5 * transform[1];
+    origin[1] = transform[3] + 0.5 * transform[5];
+    typename TImage::SpacingType spacing;
+    spacing[0] = transform[1];
+    spacing[1] = transform[5];
+
+    m_Image = TImage::New();
+    m_Image->SetRegions(region);
+    m_Image->SetNumberOfComponentsPerPixel(1);
+    m_Image->SetOrigin(origin);
+    m_Image->SetSignedSpacing(spacing);
+    const char *projection = GDALGetProjectionRef(m_Dataset);
+    if (projection && *projection) {
+      m_Image->SetProjectionRef(projection);
+    }
+
+    // The container does not own the pages; they are unmapped with the
+    // dataset, after the image is released
+    auto container = TImage::PixelContainer::New();
+    container->SetImportPointer(
+        static_cast<InternalPixelType *>(CPLVirtualMemGetAddr(m_Memory)),
+        region.GetNumberOfPixels(), false);
+    m_Image->SetPixelContainer(container);
+  }
+
+  ~MappedRasterImage() { this->Release(); }
+
+  MappedRasterImage(const MappedRasterImage &) = delete;
+  void operator=(const MappedRasterImage &) = delete;
+
+  bool IsMapped() const { return m_Image.IsNotNull(); }
+
+  /** The mapped image, null if the file could not be mapped. It must not be
+   * written to, and must not be used after this object is destroyed. */
+  ImageType *GetOutput() const { return m_Image.GetPointer(); }
+
+private:
+  void Release() {
+    m_Image = nullptr;
+    if (m_Memory) {
+      CPLVirtualMemFree(m_Memory);
+      m_Memory = nullptr;
+    }
+    if (m_Dataset) {
+      GDALClose(m_Dataset);
+      m_Dataset = nullptr;
+    }
+  }
+
+  GDALDatasetH m_Dataset;
+  CPLVirtualMem *m_Memory;
+  ImagePointer m_Image;
+};
+
+//  The output format is the one the writer would pick from the output
+//  extension, so both files are taken to have the same format when they
+//  have the same extension.  Returns false, having written nothing, when the
+//  copy does not apply; bandCount 0 accepts any number of bands.
+
+inline bool CopyRasterFiles(const std::string &inputFileName,
+                            const std::string &outputFileName,
+                            GDALDataType dataType, int bandCount) {
+  const auto extension = [](const std::string &fileName) {
+    const std::string::size_type dot = fileName.find_last_of('.');
+    const std::string::size_type slash = fileName.find_last_of("/\\");
+    if (dot == std::string::npos ||
+        (slash != std::string::npos && dot < slash)) {
+      return std::string();
+    }
+    std::string result = fileName.substr(dot + 1);
+    std::transform(result.begin(), result.end(), result.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return result;
+  };
+
+  if (inputFileName.find('?') != std::string::npos ||
+      outputFileName.find('?') != std::string::npos ||
+      inputFileName == outputFileName || extension(inputFileName).empty() ||
+      extension(inputFileName) != extension(outputFileName)) {
+    return false;
+  }
+
+  GDALAllRegister();
+  GDALDatasetH dataset = GDALOpen(inputFileName.c_str(), GA_ReadOnly);
+  if (!dataset) {
+    return false;
+  }
+
+  bool matches = GDALGetRasterCount(dataset) > 0 &&
+                 (bandCount == 0 || GDALGetRasterCount(dataset) == bandCount);
+  for (int band = 1; matches && band <= GDALGetRasterCount(dataset); ++band) {
+    matches = GDALGetRasterDataType(GDALGetRasterBand(dataset, band)) ==
+              dataType;
+  }
+  GDALDriverH driver = GDALGetDatasetDriver(dataset);
+  GDALClose(dataset);
+
+  return matches && driver &&
+         GDALCopyDatasetFiles(driver, outputFileName.c_str(),
+                              inputFileName.c_str()) == CE_None;
+}
+
+} // namespace otb
+
+#endif
@@ -0,0 +1,295 @@
+//  Opt-in per-stage profiler for the example pipelines.
+//
+//  A pipeline is usually run by a single \code{writer->Update()}, which
+//  hides how the time is shared between reading, filtering and writing.
+//  \code{PipelineProfiler} attaches \code{StartEvent}, \code{ProgressEvent}
+//  and \code{EndEvent} observers to every \doxygen{itk}{ProcessObject}
+//  upstream of a given stage, and records for each execution of each of them
+//  (once per streamed tile) the wall time, the process CPU time, the number
+//  of work units and threads, the heap bytes allocated and the pixels
+//  produced.  The records are written as a Chrome trace-event JSON file,
+//  which can be opened offline in \code{chrome://tracing} or Perfetto, and a
+//  per-stage summary is printed on the standard error.
+//
+//  The profiler does nothing unless it is enabled, either with
+//  \code{--trace <file>} on the command line (both arguments are then
+//  removed from \code{argv}, so the usual argument checks are unaffected) or
+//  with the \code{OTB\_PIPELINE\_TRACE} environment variable set to the
+//  output file name.  It is used as follows:
+//
+//  \begin{verbatim}
+//  int main(int argc, char *argv[]) {
+//    otb::PipelineProfiler profiler(argc, argv);
+//    ...
+//    profiler.Attach(writer);
+//    writer->Update();
+//  }
+//  \end{verbatim}
+//
+//  The profiler must outlive the attached process objects' updates; the
+//  trace is written when it is destroyed.  The heap measurement relies on
+//  glibc and is reported as 0 elsewhere.
+
+#ifndef PipelineProfiler_h
+#define PipelineProfiler_h
+
+#include "itkEventObject.h"
+#include "itkImageBase.h"
+#include "itkMultiThreaderBase.h"
+#include "itkProcessObject.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace otb {
+
+class PipelineProfiler {
+public:
+  PipelineProfiler(int &argc, char *argv[])
+      : m_Origin(std::chrono::steady_clock::now()) {
+    // --trace <file> takes precedence over the environment variable
+    for (int i = 1; i < argc; ++i) {
+      if (std::string(argv[i]) == "--trace" && i + 1 < argc) {
+        m_FileName = argv[i + 1];
+        for (int j = i + 2; j <= argc; ++j) {
+          argv[j - 2] = argv[j];
+        }
+        argc -= 2;
+        break;
+      }
+    }
+    if (m_FileName.empty()) {
+      const char *variable = std::getenv("OTB_PIPELINE_TRACE");
+      if (variable && *variable) {
+        m_FileName = variable;
+      }
+    }
+  }
+
+  ~PipelineProfiler() { this->Write(); }
+
+  PipelineProfiler(const PipelineProfiler &) = delete;
+  void operator=(const PipelineProfiler &) = delete;
+
+  bool IsEnabled() const { return !m_FileName.empty(); }
+
+  /** Observe the given process object and everything upstream of it. Can be
+   * called once per pipeline; stages already observed are skipped. */
+  void Attach(itk::ProcessObject *process) {
+    if (!this->IsEnabled() || !process || m_Stages.count(process)) {
+      return;
+    }
+
+    std::ostringstream name;
+    name << process->GetNameOfClass();
+    if (!process->GetObjectName().empty()) {
+      name << " " << process->GetObjectName();
+    }
+    name << " #" << m_Stages.size();
+    m_Stages[process].Name = name.str();
+
+    process->AddObserver(itk::StartEvent(),
+                         [this, process](const itk::EventObject &) {
+                           this->OnStart(process);
+                         });
+    process->AddObserver(itk::ProgressEvent(),
+                         [this, process](const itk::EventObject &) {
+                           this->OnProgress(process);
+                         });
+    process->AddObserver(itk::EndEvent(),
+                         [this, process](const itk::EventObject &) {
+                           this->OnEnd(process);
+                         });
+
+    for (const auto &input : process->GetInputs()) {
+      if (input) {
+        this->Attach(input->GetSource());
+      }
+    }
+  }
+
+  /** Write the trace file and the summary. Called by the destructor. */
+  void Write() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!this->IsEnabled() || m_Written) {
+      return;
+    }
+    m_Written = true;
+
+    std::ofstream file(m_FileName.c_str());
+    if (!file) {
+      std::cerr << "Cannot write the pipeline trace to " << m_FileName
+                << std::endl;
+      return;
+    }
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for (size_t i = 0; i < m_Events.size(); ++i) {
+      file << m_Events[i] << ((i + 1 < m_Events.size()) ? ",\n" : "\n");
+    }
+    file << "]}\n";
+
+    std::cerr << "Pipeline trace written to " << m_FileName << std::endl;
+    for (const auto &entry : m_Stages) {
+      const Stage &stage = entry.second;
+      if (stage.Executions == 0) {
+        continue;
+      }
+      std::cerr << "  " << stage.Name << ": " << stage.Executions
+                << " execution(s), " << std::fixed << std::setprecision(3)
+                << stage.WallTime << " s wall, " << stage.CPUTime
+                << " s CPU, " << stage.Pixels << " pixels" << std::endl;
+    }
+  }
+
+private:
+  struct Execution {
+    double WallStart;
+    double CPUStart;
+    long long HeapStart;
+  };
+
+  struct Stage {
+    std::string Name;
+    std::vector<Execution> Open;
+    double LastProgress = -1.0;
+    unsigned long Executions = 0;
+    double WallTime = 0.0;
+    double CPUTime = 0.0;
+    unsigned long long Pixels = 0;
+  };
+
+  double Now() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         m_Origin)
+        .count();
+  }
+
+  static double CPUTime() {
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+  }
+
+  static long long HeapBytes() {
+#if defined(__GLIBC__) &&                                                      \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    const struct mallinfo2 info = mallinfo2();
+    return static_cast<long long>(info.uordblks + info.hblkhd);
+#else
+    return 0;
+#endif
+  }
+
+  static std::string Quote(const std::string &text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+      if (c == '"' || c == '\\') {
+        quoted += '\\';
+      }
+      quoted += c;
+    }
+    return quoted + "\"";
+  }
+
+  void OnStart(itk::ProcessObject *process) {
+    const Execution execution = {this->Now(), CPUTime(), HeapBytes()};
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Stage &stage = m_Stages[process];
+    stage.Open.push_back(execution);
+    stage.LastProgress = -1.0;
+  }
+
+  //  Progress is recorded as a counter, at most once per percent.
+
+  void OnProgress(itk::ProcessObject *process) {
+    const double progress = process->GetProgress();
+    const double now = this->Now();
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Stage &stage = m_Stages[process];
+    if (progress < 1.0 && progress - stage.LastProgress < 0.01) {
+      return;
+    }
+    stage.LastProgress = progress;
+
+    std::ostringstream event;
+    event << std::fixed << std::setprecision(3)
+          << "{\"name\": " << Quote(stage.Name + " progress")
+          << ", \"ph\": \"C\", \"pid\": 1, \"tid\": 1, \"ts\": " << now * 1e6
+          << ", \"args\": {\"progress\": " << progress << "}}";
+    m_Events.push_back(event.str());
+  }
+
+  void OnEnd(itk::ProcessObject *process) {
+    const double wallEnd = this->Now();
+    const double cpuEnd = CPUTime();
+    const long long heapEnd = HeapBytes();
+
+    // The produced region is the requested region of the first image output
+    std::ostringstream region;
+    unsigned long long pixels = 0;
+    const auto *output =
+        dynamic_cast<const itk::ImageBase<2> *>(process->GetOutput(0));
+    if (output) {
+      const itk::ImageRegion<2> &requested = output->GetRequestedRegion();
+      pixels = requested.GetNumberOfPixels();
+      region << "[" << requested.GetIndex()[0] << ", "
+             << requested.GetIndex()[1] << ", " << requested.GetSize()[0]
+             << ", " << requested.GetSize()[1] << "]";
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Stage &stage = m_Stages[process];
+    if (stage.Open.empty()) {
+      return;
+    }
+    const Execution execution = stage.Open.back();
+    stage.Open.pop_back();
+
+    const double wallTime = wallEnd - execution.WallStart;
+    const double cpuTime = cpuEnd - execution.CPUStart;
+    ++stage.Executions;
+    stage.WallTime += wallTime;
+    stage.CPUTime += cpuTime;
+    stage.Pixels += pixels;
+
+    std::ostringstream event;
+    event << std::fixed << std::setprecision(3)
+          << "{\"name\": " << Quote(stage.Name)
+          << ", \"cat\": \"pipeline\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1"
+          << ", \"ts\": " << execution.WallStart * 1e6
+          << ", \"dur\": " << wallTime * 1e6
+          << ", \"args\": {\"cpu_ms\": " << cpuTime * 1e3
+          << ", \"work_units\": " << process->GetNumberOfWorkUnits()
+          << ", \"threads\": "
+          << process->GetMultiThreader()->GetMaximumNumberOfThreads()
+          << ", \"heap_bytes\": " << heapEnd - execution.HeapStart
+          << ", \"pixels\": " << pixels;
+    if (output) {
+      event << ", \"region\": " << Quote(region.str());
+    }
+    event << "}}";
+    m_Events.push_back(event.str());
+  }
+
+  std::string m_FileName;
+  std::chrono::steady_clock::time_point m_Origin;
+  std::mutex m_Mutex;
+  std::map<const itk::ProcessObject *, Stage> m_Stages;
+  std::vector<std::string> m_Events;
+  bool m_Written = false;
+};
+
+} // namespace otb
+
+#endif
@@ -0,0 +1,359 @@
+//  Linear rescaling of the intensities to an output range, like
+//  \doxygen{itk}{RescaleIntensityImageFilter}, but streamable.
+//
+//  \doxygen{itk}{RescaleIntensityImageFilter} needs the minimum and maximum
+//  of its whole input before producing any pixel, so it requests the whole
+//  input and the upstream pipeline computes and holds the full image at
+//  once.  This filter splits the work in two streamed passes.  The first
+//  computes the extrema with \doxygen{otb}{StreamingMinMaxImageFilter},
+//  tile by tile and with several threads; it runs when the output
+//  information is generated, before anything is requested downstream, and
+//  only again when the input pipeline changes.  Its tiles can be set to
+//  those of an upstream filter working per tile, so that each of its tiles
+//  is requested once by the pass.  The second is a pixel-wise mapping of
+//  each requested region, which streams like any other filter.
+//  The mapping is the one of \doxygen{itk}{RescaleIntensityImageFilter}, so
+//  both give the same output.
+//
+//  The extrema can also be stored in a sidecar file, under a key describing
+//  the input and the pipeline that produced it (see
+//  \code{RescaleStatisticsKey()}).  A later run finding its key there skips
+//  the first pass entirely, whatever its output range.  The sidecar is a
+//  text file of one \code{key minimum maximum} line per entry; writing an
+//  entry drops those of earlier versions of the same input file, so it does
+//  not grow as the input changes.  Failing to read or write it only costs
+//  the first pass.
+
+#ifndef StreamingRescaleIntensityImageFilter_h
+#define StreamingRescaleIntensityImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkNumericTraits.h"
+#include "itksys/SystemTools.hxx"
+#include "otbStreamingMinMaxImageFilter.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace otb {
+
+/** Sidecar key of the statistics of a pipeline reading the given file: the
+ * file name, its modification time and size, and a description of the
+ * processing between the file and the rescaling. Empty (no caching) if the
+ * file cannot be found. */
+inline std::string RescaleStatisticsKey(const std::string &fileName,
+                                        const std::string &parameters) {
+  if (!itksys::SystemTools::FileExists(fileName.c_str(), true)) {
+    return std::string();
+  }
+  std::ostringstream key;
+  key << itksys::SystemTools::CollapseFullPath(fileName) << "|"
+      << itksys::SystemTools::ModifiedTime(fileName) << "|"
+      << itksys::SystemTools::FileLength(fileName) << "|" << parameters;
+
+  // Keys are written as one whitespace-free token
+  std::string result = key.str();
+  std::replace_if(
+      result.begin(), result.end(),
+      [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; },
+      '_');
+  return result;
+}
+
+/** True if a sidecar key describes another version (modification time or
+ * size) of the file of the current key; false for keys not made by
+ * RescaleStatisticsKey() */
+inline bool IsStaleRescaleStatisticsKey(const std::string &key,
+                                        const std::string &currentKey) {
+  // The file part of a key is "name|time|size|"
+  auto filePart = [](const std::string &k) {
+    std::string::size_type start = 0;
+    for (int field = 0; field < 3; ++field) {
+      const std::string::size_type bar = k.find('|', start);
+      if (bar == std::string::npos) {
+        return std::string();
+      }
+      start = bar + 1;
+    }
+    return k.substr(0, start);
+  };
+  const std::string file = filePart(key);
+  const std::string currentFile = filePart(currentKey);
+  if (file.empty() || currentFile.empty() || file == currentFile) {
+    return false;
+  }
+  return file.substr(0, file.find('|')) ==
+         currentFile.substr(0, currentFile.find('|'));
+}
+
+template <class TInputImage, class TOutputImage>
+class ITK_EXPORT StreamingRescaleIntensityImageFilter
+    : public itk::ImageToImageFilter<TInputImage, TOutputImage> {
+public:
+  using Self = StreamingRescaleIntensityImageFilter<TInputImage, TOutputImage>;
+  using Superclass = itk::ImageToImageFilter<TInputImage, TOutputImage>;
+  using Pointer = itk::SmartPointer<Self>;
+  using ConstPointer = itk::SmartPointer<const Self>;
+
+  /** Method for creation through object factory */
+  itkNewMacro(Self);
+
+  /** Run-time type information */
+  itkTypeMacro(StreamingRescaleIntensityImageFilter, itk::ImageToImageFilter);
+
+  /** Display */
+  void PrintSelf(std::ostream &os, itk::Indent indent) const override;
+
+  using InputPixelType = typename TInputImage::PixelType;
+  using OutputPixelType = typename TOutputImage::PixelType;
+  using RealType = typename itk::NumericTraits<InputPixelType>::RealType;
+  using OutputImageRegionType = typename TOutputImage::RegionType;
+
+  /** Output range */
+  itkGetMacro(OutputMinimum, OutputPixelType);
+  itkSetMacro(OutputMinimum, OutputPixelType);
+  itkGetMacro(OutputMaximum, OutputPixelType);
+  itkSetMacro(OutputMaximum, OutputPixelType);
+
+  /** Extrema of the input, known once the output information is */
+  itkGetMacro(InputMinimum, InputPixelType);
+  itkGetMacro(InputMaximum, InputPixelType);
+
+  /** Sidecar file of the statistics, and key of this pipeline in it; either
+   * empty disables the cache */
+  itkGetStringMacro(StatisticsFileName);
+  itkSetStringMacro(StatisticsFileName);
+  itkGetStringMacro(StatisticsKey);
+  itkSetStringMacro(StatisticsKey);
+
+  /** Dimension of the square tiles streamed by the first pass; 0 (the
+   * default) keeps the automatic streaming of the min/max filter */
+  itkGetMacro(StatisticsTileDimension, unsigned int);
+  itkSetMacro(StatisticsTileDimension, unsigned int);
+
+protected:
+  StreamingRescaleIntensityImageFilter();
+  ~StreamingRescaleIntensityImageFilter() override = default;
+
+  void GenerateOutputInformation() override;
+  void BeforeThreadedGenerateData() override;
+  void DynamicThreadedGenerateData(
+      const OutputImageRegionType &outputRegion) override;
+
+  /** Look the extrema up in the sidecar; true if found */
+  bool ReadStatistics();
+  void WriteStatistics() const;
+
+private:
+  StreamingRescaleIntensityImageFilter(const Self &) = delete;
+  void operator=(const Self &) = delete;
+
+  using MinMaxType = otb::StreamingMinMaxImageFilter<TInputImage>;
+
+  OutputPixelType m_OutputMinimum;
+  OutputPixelType m_OutputMaximum;
+  InputPixelType m_InputMinimum;
+  InputPixelType m_InputMaximum;
+  std::string m_StatisticsFileName;
+  std::string m_StatisticsKey;
+  unsigned int m_StatisticsTileDimension;
+
+  RealType m_Scale;
+  RealType m_Shift;
+
+  typename MinMaxType::Pointer m_MinMaxFilter;
+
+  // Time of the last statistics pass, which only depends on the input
+  itk::TimeStamp m_StatisticsTime;
+  std::string m_StatisticsTimeKey;
+};
+
+} /* namespace otb */
+
+namespace otb {
+
+template <class TInputImage, class TOutputImage>
+StreamingRescaleIntensityImageFilter<
+    TInputImage, TOutputImage>::StreamingRescaleIntensityImageFilter()
+    : m_OutputMinimum(itk::NumericTraits<OutputPixelType>::NonpositiveMin()),
+      m_OutputMaximum(itk::NumericTraits<OutputPixelType>::max()),
+      m_InputMinimum(itk::NumericTraits<InputPixelType>::max()),
+      m_InputMaximum(itk::NumericTraits<InputPixelType>::NonpositiveMin()),
+      m_StatisticsTileDimension(0), m_Scale(1), m_Shift(0) {
+  m_MinMaxFilter = MinMaxType::New();
+}
+
+template <class TInputImage, class TOutputImage>
+bool StreamingRescaleIntensityImageFilter<TInputImage,
+                                          TOutputImage>::ReadStatistics() {
+  if (m_StatisticsFileName.empty() || m_StatisticsKey.empty()) {
+    return false;
+  }
+  std::ifstream file(m_StatisticsFileName.c_str());
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string key;
+    double minimum, maximum;
+    if (fields >> key >> minimum >> maximum && key == m_StatisticsKey) {
+      m_InputMinimum = static_cast<InputPixelType>(minimum);
+      m_InputMaximum = static_cast<InputPixelType>(maximum);
+      return true;
+    }
+  }
+  return false;
+}
+
+template <class TInputImage, class TOutputImage>
+void StreamingRescaleIntensityImageFilter<TInputImage,
+                                          TOutputImage>::WriteStatistics()
+    const {
+  if (m_StatisticsFileName.empty() || m_StatisticsKey.empty()) {
+    return;
+  }
+
+  // Other entries are kept, except the ones this entry replaces: the same
+  // key, and the keys of earlier versions of the input file
+  std::vector<std::string> kept;
+  {
+    std::ifstream previous(m_StatisticsFileName.c_str());
+    std::string line;
+    while (std::getline(previous, line)) {
+      std::istringstream fields(line);
+      std::string key;
+      if (fields >> key && key != m_StatisticsKey &&
+          !IsStaleRescaleStatisticsKey(key, m_StatisticsKey)) {
+        kept.push_back(line);
+      }
+    }
+  }
+
+  std::ofstream file(m_StatisticsFileName.c_str(), std::ios::trunc);
+  for (const std::string &line : kept) {
+    file << line << "\n";
+  }
+  file << m_StatisticsKey << " "
+       << std::setprecision(std::numeric_limits<double>::max_digits10)
+       << static_cast<double>(m_InputMinimum) << " "
+       << static_cast<double>(m_InputMaximum) << std::endl;
+}
+
+//  First pass.  The writer asks for the output information before it
+//  requests any region, so the extrema are known before the first tile of
+//  the second pass.
+
+template <class TInputImage, class TOutputImage>
+void StreamingRescaleIntensityImageFilter<
+    TInputImage, TOutputImage>::GenerateOutputInformation() {
+  Superclass::GenerateOutputInformation();
+
+  TInputImage *inputImage = const_cast<TInputImage *>(this->GetInput());
+  if (!inputImage) {
+    return;
+  }
+  if (m_StatisticsTime.GetMTime() > inputImage->GetPipelineMTime() &&
+      m_StatisticsTimeKey == m_StatisticsKey) {
+    return;
+  }
+
+  if (!this->ReadStatistics()) {
+    m_MinMaxFilter->SetInput(inputImage);
+    if (m_StatisticsTileDimension > 0) {
+      m_MinMaxFilter->GetStreamer()->SetTileDimensionTiledStreaming(
+          m_StatisticsTileDimension);
+    }
+    m_MinMaxFilter->Update();
+    m_InputMinimum = m_MinMaxFilter->GetMinimum();
+    m_InputMaximum = m_MinMaxFilter->GetMaximum();
+    this->WriteStatistics();
+  }
+  m_StatisticsTime.Modified();
+  m_StatisticsTimeKey = m_StatisticsKey;
+}
+
+//  Same factor and offset as itk::RescaleIntensityImageFilter.
+
+template <class TInputImage, class TOutputImage>
+void StreamingRescaleIntensityImageFilter<
+    TInputImage, TOutputImage>::BeforeThreadedGenerateData() {
+  const RealType outputRange = static_cast<RealType>(m_OutputMaximum) -
+                               static_cast<RealType>(m_OutputMinimum);
+  if (m_InputMinimum != m_InputMaximum) {
+    m_Scale = outputRange / (static_cast<RealType>(m_InputMaximum) -
+                             static_cast<RealType>(m_InputMinimum));
+  } else if (m_InputMaximum !=
+             itk::NumericTraits<InputPixelType>::ZeroValue()) {
+    m_Scale = outputRange / static_cast<RealType>(m_InputMaximum);
+  } else {
+    m_Scale = 0.0;
+  }
+  m_Shift = static_cast<RealType>(m_OutputMinimum) -
+            static_cast<RealType>(m_InputMinimum) * m_Scale;
+}
+
+template <class TInputImage, class TOutputImage>
+void StreamingRescaleIntensityImageFilter<TInputImage, TOutputImage>::
+    DynamicThreadedGenerateData(const OutputImageRegionType &outputRegion) {
+  const TInputImage *inputImage = this->GetInput();
+  TOutputImage *outputImage = this->GetOutput();
+
+  const long width = outputRegion.GetSize()[0];
+  const long height = outputRegion.GetSize()[1];
+  const long inputStride = inputImage->GetBufferedRegion().GetSize()[0];
+  const long outputStride = outputImage->GetBufferedRegion().GetSize()[0];
+
+  const InputPixelType *inputRow =
+      inputImage->GetBufferPointer() +
+      inputImage->ComputeOffset(outputRegion.GetIndex());
+  OutputPixelType *outputRow =
+      outputImage->GetBufferPointer() +
+      outputImage->ComputeOffset(outputRegion.GetIndex());
+
+  for (long y = 0; y < height;
+       ++y, inputRow += inputStride, outputRow += outputStride) {
+    for (long x = 0; x < width; ++x) {
+      const RealType value =
+          static_cast<RealType>(inputRow[x]) * m_Scale + m_Shift;
+      OutputPixelType result = static_cast<OutputPixelType>(value);
+      result = (result > m_OutputMaximum) ? m_OutputMaximum : result;
+      result = (result < m_OutputMinimum) ? m_OutputMinimum : result;
+      outputRow[x] = result;
+    }
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+void StreamingRescaleIntensityImageFilter<TInputImage, TOutputImage>::
+    PrintSelf(std::ostream &os, itk::Indent indent) const {
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "OutputMinimum: "
+     << static_cast<typename itk::NumericTraits<OutputPixelType>::PrintType>(
+            m_OutputMinimum)
+     << std::endl;
+  os << indent << "OutputMaximum: "
+     << static_cast<typename itk::NumericTraits<OutputPixelType>::PrintType>(
+            m_OutputMaximum)
+     << std::endl;
+  os << indent << "InputMinimum: "
+     << static_cast<typename itk::NumericTraits<InputPixelType>::PrintType>(
+            m_InputMinimum)
+     << std::endl;
+  os << indent << "InputMaximum: "
+     << static_cast<typename itk::NumericTraits<InputPixelType>::PrintType>(
+            m_InputMaximum)
+     << std::endl;
+  os << indent << "StatisticsFileName: " << m_StatisticsFileName << std::endl;
+  os << indent << "StatisticsKey: " << m_StatisticsKey << std::endl;
+  os << indent << "StatisticsTileDimension: " << m_StatisticsTileDimension
+     << std::endl;
+}
+
+} /* end namespace otb */
+
+#endif
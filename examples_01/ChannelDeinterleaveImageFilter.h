@@ -0,0 +1,310 @@
+//  Extracts several channels of a \doxygen{otb}{VectorImage} in a single
+//  pass, one mono-channel output image per channel.
+//
+//  \doxygen{otb}{MultiToMonoChannelExtractROI} extracts one channel, so
+//  getting $K$ channels out of an interleaved image means $K$ pipelines,
+//  each reading the whole input.  This filter reads each input pixel once
+//  and scatters the requested channels to its $K$ outputs, which stream
+//  together: all the outputs share the requested region of the one that
+//  triggered the update, so a \doxygen{otb}{MultiImageFileWriter} writes them
+//  in parallel from a single read of the input.
+//
+//  Channels are numbered from 1, as in the OTB extraction filters, and may
+//  be given in any order or more than once.  For \code{unsigned short}
+//  images of 4 or 8 bands, the common layouts of multispectral products,
+//  rows are de-interleaved 8 pixels at a time with SSE2 unpack instructions
+//  (a transpose of the 16-bit values) when the CPU supports them, and with a
+//  scalar loop otherwise; the results are identical.
+
+#ifndef ChannelDeinterleaveImageFilter_h
+#define ChannelDeinterleaveImageFilter_h
+
+#include "itkImageToImageFilter.h"
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OTB_CHANNEL_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace otb {
+
+namespace ChannelKernels {
+
+/** Scalar de-interleave of the pixels begin .. end - 1 of a row: out[k]
+ * receives the 0-based band channels[k] of each pixel */
+template <class TInput, class TOutput>
+inline void DeinterleaveScalar(const TInput *in, unsigned int nbBands,
+                               const unsigned int *channels,
+                               unsigned int nbChannels, TOutput *const *out,
+                               long begin, long end) {
+  for (unsigned int k = 0; k < nbChannels; ++k) {
+    const TInput *value = in + begin * nbBands + channels[k];
+    TOutput *output = out[k];
+    for (long i = begin; i < end; ++i, value += nbBands) {
+      output[i] = static_cast<TOutput>(*value);
+    }
+  }
+}
+
+#ifdef OTB_CHANNEL_X86_DISPATCH
+
+//  Four bands: two pixels per register.  Two rounds of 16-bit unpacks
+//  gather each band of four pixels in one half of a register, and a 64-bit
+//  unpack joins the halves of the two groups of four pixels.
+
+__attribute__((target("sse2"))) inline void
+Deinterleave4x16SSE2(const unsigned short *in, const unsigned int *channels,
+                     unsigned int nbChannels, unsigned short *const *out,
+                     long n) {
+  long i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m128i *pixels = reinterpret_cast<const __m128i *>(in + 4 * i);
+    const __m128i a = _mm_loadu_si128(pixels);
+    const __m128i b = _mm_loadu_si128(pixels + 1);
+    const __m128i c = _mm_loadu_si128(pixels + 2);
+    const __m128i d = _mm_loadu_si128(pixels + 3);
+
+    const __m128i u0 = _mm_unpacklo_epi16(a, b);
+    const __m128i u1 = _mm_unpackhi_epi16(a, b);
+    const __m128i u2 = _mm_unpacklo_epi16(c, d);
+    const __m128i u3 = _mm_unpackhi_epi16(c, d);
+
+    const __m128i v0 = _mm_unpacklo_epi16(u0, u1);
+    const __m128i v1 = _mm_unpackhi_epi16(u0, u1);
+    const __m128i v2 = _mm_unpacklo_epi16(u2, u3);
+    const __m128i v3 = _mm_unpackhi_epi16(u2, u3);
+
+    const __m128i bands[4] = {
+        _mm_unpacklo_epi64(v0, v2), _mm_unpackhi_epi64(v0, v2),
+        _mm_unpacklo_epi64(v1, v3), _mm_unpackhi_epi64(v1, v3)};
+    for (unsigned int k = 0; k < nbChannels; ++k) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out[k] + i),
+                       bands[channels[k]]);
+    }
+  }
+  DeinterleaveScalar(in, 4, channels, nbChannels, out, i, n);
+}
+
+//  Eight bands: one pixel per register, and an 8x8 transpose by 16-, 32-
+//  and 64-bit unpacks.
+
+__attribute__((target("sse2"))) inline void
+Deinterleave8x16SSE2(const unsigned short *in, const unsigned int *channels,
+                     unsigned int nbChannels, unsigned short *const *out,
+                     long n) {
+  long i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m128i *pixels = reinterpret_cast<const __m128i *>(in + 8 * i);
+    __m128i s[8];
+    for (int p = 0; p < 8; p += 2) {
+      const __m128i first = _mm_loadu_si128(pixels + p);
+      const __m128i second = _mm_loadu_si128(pixels + p + 1);
+      s[p] = _mm_unpacklo_epi16(first, second);
+      s[p + 1] = _mm_unpackhi_epi16(first, second);
+    }
+
+    __m128i t[8];
+    for (int q = 0; q < 8; q += 4) {
+      t[q / 2] = _mm_unpacklo_epi32(s[q], s[q + 2]);
+      t[q / 2 + 1] = _mm_unpackhi_epi32(s[q], s[q + 2]);
+      t[q / 2 + 4] = _mm_unpacklo_epi32(s[q + 1], s[q + 3]);
+      t[q / 2 + 5] = _mm_unpackhi_epi32(s[q + 1], s[q + 3]);
+    }
+
+    __m128i bands[8];
+    for (int q = 0; q < 4; ++q) {
+      const int group = (q / 2) * 4 + q % 2;
+      bands[2 * q] = _mm_unpacklo_epi64(t[group], t[group + 2]);
+      bands[2 * q + 1] = _mm_unpackhi_epi64(t[group], t[group + 2]);
+    }
+    for (unsigned int k = 0; k < nbChannels; ++k) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out[k] + i),
+                       bands[channels[k]]);
+    }
+  }
+  DeinterleaveScalar(in, 8, channels, nbChannels, out, i, n);
+}
+
+#endif
+
+/** Row kernel for the given band count, or null if only the scalar loop
+ * applies. Only unsigned short to unsigned short has vector kernels. */
+template <class TInput, class TOutput> struct DeinterleaveSelector {
+  using KernelType = void (*)(const TInput *, const unsigned int *,
+                              unsigned int, TOutput *const *, long);
+  static KernelType Select(unsigned int) { return nullptr; }
+};
+
+template <> struct DeinterleaveSelector<unsigned short, unsigned short> {
+  using KernelType = void (*)(const unsigned short *, const unsigned int *,
+                              unsigned int, unsigned short *const *, long);
+  static KernelType Select(unsigned int nbBands) {
+#ifdef OTB_CHANNEL_X86_DISPATCH
+    if (__builtin_cpu_supports("sse2")) {
+      if (nbBands == 4) {
+        return Deinterleave4x16SSE2;
+      }
+      if (nbBands == 8) {
+        return Deinterleave8x16SSE2;
+      }
+    }
+#endif
+    (void)nbBands;
+    return nullptr;
+  }
+};
+
+} // namespace ChannelKernels
+
+template <class TInputImage, class TOutputImage>
+class ITK_EXPORT ChannelDeinterleaveImageFilter
+    : public itk::ImageToImageFilter<TInputImage, TOutputImage> {
+public:
+  using Self = ChannelDeinterleaveImageFilter<TInputImage, TOutputImage>;
+  using Superclass = itk::ImageToImageFilter<TInputImage, TOutputImage>;
+  using Pointer = itk::SmartPointer<Self>;
+  using ConstPointer = itk::SmartPointer<const Self>;
+
+  /** Method for creation through object factory */
+  itkNewMacro(Self);
+
+  /** Run-time type information */
+  itkTypeMacro(ChannelDeinterleaveImageFilter, itk::ImageToImageFilter);
+
+  /** Display */
+  void PrintSelf(std::ostream &os, itk::Indent indent) const override;
+
+  using InputInternalPixelType = typename TInputImage::InternalPixelType;
+  using OutputPixelType = typename TOutputImage::PixelType;
+  using OutputImageRegionType = typename TOutputImage::RegionType;
+
+  /** Channels to extract, numbered from 1; output k holds channels[k] */
+  void SetChannels(const std::vector<unsigned int> &channels) {
+    if (m_Channels != channels) {
+      m_Channels = channels;
+      const unsigned int nbOutputs =
+          std::max<unsigned int>(m_Channels.size(), 1);
+      this->SetNumberOfRequiredOutputs(nbOutputs);
+      for (unsigned int k = 0; k < nbOutputs; ++k) {
+        if (!this->GetOutput(k)) {
+          this->SetNthOutput(k, this->MakeOutput(k));
+        }
+      }
+      this->Modified();
+    }
+  }
+  itkGetConstReferenceMacro(Channels, std::vector<unsigned int>);
+
+  /** Use the vector kernels when they apply (on by default) */
+  itkGetMacro(UseSIMD, bool);
+  itkSetMacro(UseSIMD, bool);
+  itkBooleanMacro(UseSIMD);
+
+protected:
+  ChannelDeinterleaveImageFilter() : m_UseSIMD(true) {}
+  ~ChannelDeinterleaveImageFilter() override = default;
+
+  void GenerateOutputInformation() override;
+  void DynamicThreadedGenerateData(
+      const OutputImageRegionType &outputRegion) override;
+
+private:
+  ChannelDeinterleaveImageFilter(const Self &) = delete;
+  void operator=(const Self &) = delete;
+
+  std::vector<unsigned int> m_Channels;
+  bool m_UseSIMD;
+};
+
+} /* namespace otb */
+
+namespace otb {
+
+template <class TInputImage, class TOutputImage>
+void ChannelDeinterleaveImageFilter<TInputImage,
+                                    TOutputImage>::GenerateOutputInformation() {
+  Superclass::GenerateOutputInformation();
+
+  if (m_Channels.empty()) {
+    itkExceptionMacro(<< "No channel set.");
+  }
+  const unsigned int nbBands =
+      this->GetInput()->GetNumberOfComponentsPerPixel();
+  for (unsigned int channel : m_Channels) {
+    if (channel < 1 || channel > nbBands) {
+      itkExceptionMacro(<< "Channel " << channel << " requested but the input "
+                        << "image has " << nbBands << " band(s).");
+    }
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+void ChannelDeinterleaveImageFilter<TInputImage, TOutputImage>::
+    DynamicThreadedGenerateData(const OutputImageRegionType &outputRegion) {
+  using SelectorType =
+      ChannelKernels::DeinterleaveSelector<InputInternalPixelType,
+                                           OutputPixelType>;
+
+  const TInputImage *inputImage = this->GetInput();
+  const unsigned int nbBands = inputImage->GetNumberOfComponentsPerPixel();
+  const unsigned int nbChannels = m_Channels.size();
+
+  std::vector<unsigned int> channels(nbChannels);
+  for (unsigned int k = 0; k < nbChannels; ++k) {
+    channels[k] = m_Channels[k] - 1;
+  }
+  const typename SelectorType::KernelType kernel =
+      m_UseSIMD ? SelectorType::Select(nbBands) : nullptr;
+
+  // Rows of the region are contiguous in every buffer; the input holds
+  // nbBands interleaved values per pixel
+  const long width = outputRegion.GetSize()[0];
+  const long height = outputRegion.GetSize()[1];
+  const long inputStride =
+      inputImage->GetBufferedRegion().GetSize()[0] * nbBands;
+  const InputInternalPixelType *inputRow =
+      inputImage->GetBufferPointer() +
+      inputImage->ComputeOffset(outputRegion.GetIndex()) * nbBands;
+
+  std::vector<OutputPixelType *> outputRows(nbChannels);
+  std::vector<long> outputStrides(nbChannels);
+  for (unsigned int k = 0; k < nbChannels; ++k) {
+    TOutputImage *outputImage = this->GetOutput(k);
+    outputRows[k] = outputImage->GetBufferPointer() +
+                    outputImage->ComputeOffset(outputRegion.GetIndex());
+    outputStrides[k] = outputImage->GetBufferedRegion().GetSize()[0];
+  }
+
+  for (long y = 0; y < height; ++y, inputRow += inputStride) {
+    if (kernel) {
+      kernel(inputRow, channels.data(), nbChannels, outputRows.data(), width);
+    } else {
+      ChannelKernels::DeinterleaveScalar(inputRow, nbBands, channels.data(),
+                                         nbChannels, outputRows.data(), 0,
+                                         width);
+    }
+    for (unsigned int k = 0; k < nbChannels; ++k) {
+      outputRows[k] += outputStrides[k];
+    }
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+void ChannelDeinterleaveImageFilter<TInputImage, TOutputImage>::PrintSelf(
+    std::ostream &os, itk::Indent indent) const {
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Channels:";
+  for (unsigned int channel : m_Channels) {
+    os << " " << channel;
+  }
+  os << std::endl;
+  os << indent << "UseSIMD: " << this->m_UseSIMD << std::endl;
+}
+
+} /* end namespace otb */
+
+#endif
@@ -0,0 +1,225 @@
+//  Extracts and reorders channels of a \doxygen{otb}{VectorImage} into
+//  another vector image, in a single pass.
+//
+//  This is the vector-image counterpart of ChannelDeinterleaveImageFilter:
+//  output band k holds the input channel channels[k] (numbered from 1), so
+//  the filter selects a subset of the bands, reorders them (BGRN to RGBN,
+//  for instance) or both.  When all the bands of an \code{unsigned short}
+//  image of 4 or 8 bands are kept, the pixels are reordered 16 bytes at a
+//  time with the SSSE3 byte shuffle when the CPU supports it.
+
+#ifndef ChannelReorderImageFilter_h
+#define ChannelReorderImageFilter_h
+
+#include "ChannelDeinterleaveImageFilter.h"
+
+namespace otb {
+
+namespace ChannelKernels {
+
+/** Scalar reorder of the pixels begin .. end - 1 of a row */
+template <class TInput, class TOutput>
+inline void ReorderScalar(const TInput *in, unsigned int nbBands,
+                          const unsigned int *channels,
+                          unsigned int nbChannels, TOutput *out, long begin,
+                          long end) {
+  const TInput *pixel = in + begin * nbBands;
+  TOutput *output = out + begin * nbChannels;
+  for (long i = begin; i < end; ++i, pixel += nbBands) {
+    for (unsigned int k = 0; k < nbChannels; ++k, ++output) {
+      *output = static_cast<TOutput>(pixel[channels[k]]);
+    }
+  }
+}
+
+#ifdef OTB_CHANNEL_X86_DISPATCH
+
+//  8 bands make one pixel per register and 4 bands two, so a single shuffle
+//  mask, built once per row, reorders every register.
+
+__attribute__((target("ssse3"))) inline void
+Reorder16SSSE3(const unsigned short *in, unsigned int nbBands,
+               const unsigned int *channels, unsigned short *out, long n) {
+  alignas(16) unsigned char mask[16];
+  for (unsigned int j = 0; j < 8; ++j) {
+    const unsigned int source =
+        (j / nbBands) * nbBands + channels[j % nbBands];
+    mask[2 * j] = static_cast<unsigned char>(2 * source);
+    mask[2 * j + 1] = static_cast<unsigned char>(2 * source + 1);
+  }
+  const __m128i shuffle =
+      _mm_load_si128(reinterpret_cast<const __m128i *>(mask));
+
+  const long pixelsPerRegister = 8 / nbBands;
+  long i = 0;
+  for (; i + pixelsPerRegister <= n; i += pixelsPerRegister) {
+    const __m128i pixels =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * nbBands));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * nbBands),
+                     _mm_shuffle_epi8(pixels, shuffle));
+  }
+  ReorderScalar(in, nbBands, channels, nbBands, out, i, n);
+}
+
+#endif
+
+/** Row kernel for a reorder keeping all nbBands bands, or null if only the
+ * scalar loop applies */
+template <class TInput, class TOutput> struct ReorderSelector {
+  using KernelType = void (*)(const TInput *, unsigned int,
+                              const unsigned int *, TOutput *, long);
+  static KernelType Select(unsigned int) { return nullptr; }
+};
+
+template <> struct ReorderSelector<unsigned short, unsigned short> {
+  using KernelType = void (*)(const unsigned short *, unsigned int,
+                              const unsigned int *, unsigned short *, long);
+  static KernelType Select(unsigned int nbBands) {
+#ifdef OTB_CHANNEL_X86_DISPATCH
+    if ((nbBands == 4 || nbBands == 8) && __builtin_cpu_supports("ssse3")) {
+      return Reorder16SSSE3;
+    }
+#endif
+    (void)nbBands;
+    return nullptr;
+  }
+};
+
+} // namespace ChannelKernels
+
+template <class TInputImage, class TOutputImage>
+class ITK_EXPORT ChannelReorderImageFilter
+    : public itk::ImageToImageFilter<TInputImage, TOutputImage> {
+public:
+  using Self = ChannelReorderImageFilter<TInputImage, TOutputImage>;
+  using Superclass = itk::ImageToImageFilter<TInputImage, TOutputImage>;
+  using Pointer = itk::SmartPointer<Self>;
+  using ConstPointer = itk::SmartPointer<const Self>;
+
+  /** Method for creation through object factory */
+  itkNewMacro(Self);
+
+  /** Run-time type information */
+  itkTypeMacro(ChannelReorderImageFilter, itk::ImageToImageFilter);
+
+  /** Display */
+  void PrintSelf(std::ostream &os, itk::Indent indent) const override;
+
+  using InputInternalPixelType = typename TInputImage::InternalPixelType;
+  using OutputInternalPixelType = typename TOutputImage::InternalPixelType;
+  using OutputImageRegionType = typename TOutputImage::RegionType;
+
+  /** Channels to extract, numbered from 1; output band k holds channels[k] */
+  void SetChannels(const std::vector<unsigned int> &channels) {
+    if (m_Channels != channels) {
+      m_Channels = channels;
+      this->Modified();
+    }
+  }
+  itkGetConstReferenceMacro(Channels, std::vector<unsigned int>);
+
+  /** Use the vector kernel when it applies (on by default) */
+  itkGetMacro(UseSIMD, bool);
+  itkSetMacro(UseSIMD, bool);
+  itkBooleanMacro(UseSIMD);
+
+protected:
+  ChannelReorderImageFilter() : m_UseSIMD(true) {}
+  ~ChannelReorderImageFilter() override = default;
+
+  void GenerateOutputInformation() override;
+  void DynamicThreadedGenerateData(
+      const OutputImageRegionType &outputRegion) override;
+
+private:
+  ChannelReorderImageFilter(const Self &) = delete;
+  void operator=(const Self &) = delete;
+
+  std::vector<unsigned int> m_Channels;
+  bool m_UseSIMD;
+};
+
+} /* namespace otb */
+
+namespace otb {
+
+template <class TInputImage, class TOutputImage>
+void ChannelReorderImageFilter<TInputImage,
+                               TOutputImage>::GenerateOutputInformation() {
+  Superclass::GenerateOutputInformation();
+
+  if (m_Channels.empty()) {
+    itkExceptionMacro(<< "No channel set.");
+  }
+  const unsigned int nbBands =
+      this->GetInput()->GetNumberOfComponentsPerPixel();
+  for (unsigned int channel : m_Channels) {
+    if (channel < 1 || channel > nbBands) {
+      itkExceptionMacro(<< "Channel " << channel << " requested but the input "
+                        << "image has " << nbBands << " band(s).");
+    }
+  }
+  this->GetOutput()->SetNumberOfComponentsPerPixel(m_Channels.size());
+}
+
+template <class TInputImage, class TOutputImage>
+void ChannelReorderImageFilter<TInputImage, TOutputImage>::
+    DynamicThreadedGenerateData(const OutputImageRegionType &outputRegion) {
+  using SelectorType =
+      ChannelKernels::ReorderSelector<InputInternalPixelType,
+                                      OutputInternalPixelType>;
+
+  const TInputImage *inputImage = this->GetInput();
+  TOutputImage *outputImage = this->GetOutput();
+  const unsigned int nbBands = inputImage->GetNumberOfComponentsPerPixel();
+  const unsigned int nbChannels = m_Channels.size();
+
+  std::vector<unsigned int> channels(nbChannels);
+  for (unsigned int k = 0; k < nbChannels; ++k) {
+    channels[k] = m_Channels[k] - 1;
+  }
+  const typename SelectorType::KernelType kernel =
+      (m_UseSIMD && nbChannels == nbBands) ? SelectorType::Select(nbBands)
+                                           : nullptr;
+
+  const long width = outputRegion.GetSize()[0];
+  const long height = outputRegion.GetSize()[1];
+  const long inputStride =
+      inputImage->GetBufferedRegion().GetSize()[0] * nbBands;
+  const long outputStride =
+      outputImage->GetBufferedRegion().GetSize()[0] * nbChannels;
+
+  const InputInternalPixelType *inputRow =
+      inputImage->GetBufferPointer() +
+      inputImage->ComputeOffset(outputRegion.GetIndex()) * nbBands;
+  OutputInternalPixelType *outputRow =
+      outputImage->GetBufferPointer() +
+      outputImage->ComputeOffset(outputRegion.GetIndex()) * nbChannels;
+
+  for (long y = 0; y < height;
+       ++y, inputRow += inputStride, outputRow += outputStride) {
+    if (kernel) {
+      kernel(inputRow, nbBands, channels.data(), outputRow, width);
+    } else {
+      ChannelKernels::ReorderScalar(inputRow, nbBands, channels.data(),
+                                    nbChannels, outputRow, 0, width);
+    }
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+void ChannelReorderImageFilter<TInputImage, TOutputImage>::PrintSelf(
+    std::ostream &os, itk::Indent indent) const {
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Channels:";
+  for (unsigned int channel : m_Channels) {
+    os << " " << channel;
+  }
+  os << std::endl;
+  os << indent << "UseSIMD: " << this->m_UseSIMD << std::endl;
+}
+
+} /* end namespace otb */
+
+#endif
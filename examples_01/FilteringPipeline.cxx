@@ -4,7 +4,11 @@
 #include "otbImageFileWriter.h"
 #include <cstdlib>
 
+#include "PipelineProfiler.h"
+
 int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
   if (argc != 3) {
     std::cerr << "Usage: " << argv[0] << " <input_filename> <output_filename>"
               << std::endl;
@@ -26,6 +30,7 @@ int main(int argc, char *argv[]) {
   filter->SetInput(reader->GetOutput());
   writer->SetInput(filter->GetOutput());
 
+  profiler.Attach(writer);
   writer->Update();
 
   return EXIT_SUCCESS;
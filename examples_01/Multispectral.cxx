@@ -1,15 +1,55 @@
-#include "itkShiftScaleImageFilter.h"
+#include "otbImage.h"
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
-#include "otbMultiToMonoChannelExtractROI.h"
-#include "otbPerBandVectorImageFilter.h"
+#include "otbMultiImageFileWriter.h"
+#include "otbVectorImage.h"
+#include <algorithm>
 #include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ChannelDeinterleaveImageFilter.h"
+#include "ChannelReorderImageFilter.h"
+#include "PipelineProfiler.h"
+#include "VectorShiftScaleImageFilter.h"
 
 int main(int argc, char *argv[]) {
-  if (argc != 4) {
+  otb::PipelineProfiler profiler(argc, argv);
+
+  if (argc < 4) {
     std::cerr << "Usage: " << argv[0]
               << " <input_filename> <output_extract> <output_shifted_scaled>"
+              << " [--vector] [channel ...]" << std::endl;
+    std::cerr << "  Channels default to 3. Several channels are written to "
+                 "<output_extract> with \"_<channel>\" inserted before the "
+                 "extension, or, with --vector, as the bands of one image"
               << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  bool vectorOutput = false;
+  std::vector<unsigned int> channels;
+  for (int i = 4; i < argc; ++i) {
+    if (std::string(argv[i]) == "--vector") {
+      vectorOutput = true;
+    } else {
+      channels.push_back(::atoi(argv[i]));
+    }
+  }
+  if (channels.empty()) {
+    channels.push_back(3);
+  }
+
+  // The mono images are named after their channel, so a repeated channel
+  // would have two outputs written to the same file
+  std::vector<unsigned int> sortedChannels(channels);
+  std::sort(sortedChannels.begin(), sortedChannels.end());
+  if (!vectorOutput && std::adjacent_find(sortedChannels.begin(),
+                                          sortedChannels.end()) !=
+                           sortedChannels.end()) {
+    std::cerr << "A channel is given twice; use --vector to repeat bands"
+              << std::endl;
+    return EXIT_FAILURE;
   }
 
   using PixelType = unsigned short;
@@ -20,43 +60,69 @@ int main(int argc, char *argv[]) {
 
   reader->SetFileName(argv[1]);
 
-  using ExtractChannelType =
-      otb::MultiToMonoChannelExtractROI<PixelType, PixelType>;
-  ExtractChannelType::Pointer extractChannel = ExtractChannelType::New();
+  // All the channels are extracted in one pass over the interleaved input
+  using ImageType = otb::Image<PixelType, 2>;
+  using DeinterleaveType =
+      otb::ChannelDeinterleaveImageFilter<VectorImageType, ImageType>;
+  DeinterleaveType::Pointer deinterleave = DeinterleaveType::New();
+  deinterleave->SetChannels(channels);
+  deinterleave->SetInput(reader->GetOutput());
 
-  reader->UpdateOutputInformation();
-  extractChannel->SetExtractionRegion(
-      reader->GetOutput()->GetLargestPossibleRegion());
-  extractChannel->SetChannel(3);
-  extractChannel->SetInput(reader->GetOutput());
+  using ReorderType =
+      otb::ChannelReorderImageFilter<VectorImageType, VectorImageType>;
+  ReorderType::Pointer reorder = ReorderType::New();
+  reorder->SetChannels(channels);
+  reorder->SetInput(reader->GetOutput());
 
-  using ImageType = otb::Image<PixelType, 2>;
-  using WriterType = otb::ImageFileWriter<ImageType>;
-  WriterType::Pointer writer = WriterType::New();
+  if (vectorOutput) {
+    using VectorWriterType = otb::ImageFileWriter<VectorImageType>;
+    VectorWriterType::Pointer writer = VectorWriterType::New();
+    writer->SetFileName(argv[2]);
+    writer->SetInput(reorder->GetOutput());
 
-  writer->SetFileName(argv[2]);
-  writer->SetInput(extractChannel->GetOutput());
+    profiler.Attach(writer);
+    writer->Update();
+  } else {
+    // The mono images are written together, streamed from a single read
+    const std::string extractName = argv[2];
+    std::string::size_type dot = extractName.find_last_of('.');
+    const std::string::size_type slash = extractName.find_last_of("/\\");
+    if (dot == std::string::npos ||
+        (slash != std::string::npos && dot < slash)) {
+      dot = extractName.size();
+    }
 
-  writer->Update();
+    otb::MultiImageFileWriter::Pointer writer =
+        otb::MultiImageFileWriter::New();
+    for (unsigned int k = 0; k < channels.size(); ++k) {
+      const std::string fileName =
+          channels.size() == 1
+              ? extractName
+              : extractName.substr(0, dot) + "_" +
+                    std::to_string(channels[k]) + extractName.substr(dot);
+      writer->AddInputImage(deinterleave->GetOutput(k), fileName);
+    }
 
-  using ShiftScaleType = itk::ShiftScaleImageFilter<ImageType, ImageType>;
+    profiler.Attach(writer);
+    writer->Update();
+  }
+
+  // Same shift and scale on every band, in one pass over the interleaved
+  // buffer
+  using ShiftScaleType =
+      otb::VectorShiftScaleImageFilter<VectorImageType, VectorImageType>;
   ShiftScaleType::Pointer shiftScale = ShiftScaleType::New();
   shiftScale->SetScale(0.5);
   shiftScale->SetShift(10);
-
-  using VectorFilterType =
-      otb::PerBandVectorImageFilter<VectorImageType, VectorImageType,
-                                    ShiftScaleType>;
-  VectorFilterType::Pointer vectorFilter = VectorFilterType::New();
-  vectorFilter->SetFilter(shiftScale);
-  vectorFilter->SetInput(reader->GetOutput());
+  shiftScale->SetInput(reader->GetOutput());
 
   using VectorWriterType = otb::ImageFileWriter<VectorImageType>;
   VectorWriterType::Pointer writerVector = VectorWriterType::New();
 
   writerVector->SetFileName(argv[3]);
-  writerVector->SetInput(vectorFilter->GetOutput());
+  writerVector->SetInput(shiftScale->GetOutput());
 
+  profiler.Attach(writerVector);
   writerVector->Update();
 
   return EXIT_SUCCESS;
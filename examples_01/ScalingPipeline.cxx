@@ -1,48 +1,89 @@
-#include "itkCannyEdgeDetectionImageFilter.h"
-#include "itkRescaleIntensityImageFilter.h"
 #include "itkUnaryFunctorImageFilter.h"
 #include "otbImage.h"
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
 #include <cstdlib>
+#include <string>
 
-int main(int argc, char *argv[]) {
-  if (argc != 3) {
-    std::cerr << "Usage: " << argv[0] << " <input_filename> <output_filename>"
-              << std::endl;
-  }
+#include "ComputePrecision.h"
+#include "PipelineProfiler.h"
+#include "StreamingRescaleIntensityImageFilter.h"
+#include "TiledCannyEdgeDetectionImageFilter.h"
 
-  using PixelType = double;
+// The pipeline, for images of TReal pixels (float or double)
+template <class TReal>
+int Run(char *argv[], otb::PipelineProfiler &profiler,
+        otb::ComputePrecision precision) {
+  using PixelType = TReal;
   using ImageType = otb::Image<PixelType, 2>;
 
   using OutputPixelType = unsigned char;
   using OutputImageType = otb::Image<OutputPixelType, 2>;
 
   using ReaderType = otb::ImageFileReader<ImageType>;
-  ReaderType::Pointer reader = ReaderType::New();
+  typename ReaderType::Pointer reader = ReaderType::New();
 
   using WriterType = otb::ImageFileWriter<OutputImageType>;
-  WriterType::Pointer writer = WriterType::New();
+  typename WriterType::Pointer writer = WriterType::New();
 
   reader->SetFileName(argv[1]);
   writer->SetFileName(argv[2]);
 
-  using FilterType = itk::CannyEdgeDetectionImageFilter<ImageType, ImageType>;
-  FilterType::Pointer filter = FilterType::New();
+  // Same output as itk::CannyEdgeDetectionImageFilter, computed per tile
+  using FilterType =
+      otb::TiledCannyEdgeDetectionImageFilter<ImageType, ImageType>;
+  typename FilterType::Pointer filter = FilterType::New();
+
+  // Every consumer streams on the Canny tiles: the writer, and below the
+  // statistics pass of the rescaling, each requesting every tile once
+  const unsigned int tileSize = 512;
+  typename FilterType::SizeType tile;
+  tile.Fill(tileSize);
+  filter->SetTileSize(tile);
+  writer->SetTileDimensionTiledStreaming(tileSize);
 
   using RescalerType =
-      itk::RescaleIntensityImageFilter<ImageType, OutputImageType>;
-  RescalerType::Pointer rescaler = RescalerType::New();
+      otb::StreamingRescaleIntensityImageFilter<ImageType, OutputImageType>;
+  typename RescalerType::Pointer rescaler = RescalerType::New();
 
   rescaler->SetOutputMinimum(0);
   rescaler->SetOutputMaximum(255);
+  rescaler->SetStatisticsTileDimension(tileSize);
+
+  // The extrema of the edges are kept next to the input for later runs; they
+  // depend on the precision of the edges
+  rescaler->SetStatisticsFileName(std::string(argv[1]) + ".rescale-stats");
+  rescaler->SetStatisticsKey(otb::RescaleStatisticsKey(
+      argv[1], std::string("ScalingPipeline:Canny:") +
+                   otb::ComputePrecisionName(precision)));
 
   // Pipeline
   filter->SetInput(reader->GetOutput());
   rescaler->SetInput(filter->GetOutput());
   writer->SetInput(rescaler->GetOutput());
 
+  profiler.Attach(writer);
   writer->Update();
 
   return EXIT_SUCCESS;
 }
+
+int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
+  // Pixel type of the computations (--precision f32|f64, f64 by default)
+  otb::ComputePrecision precision;
+  if (!otb::ParseComputePrecision(argc, argv, precision)) {
+    return EXIT_FAILURE;
+  }
+
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <input_filename> <output_filename>"
+              << " [--precision f32|f64]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return precision == otb::ComputePrecision::Float32
+             ? Run<float>(argv, profiler, precision)
+             : Run<double>(argv, profiler, precision);
+}
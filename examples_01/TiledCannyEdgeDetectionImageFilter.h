@@ -0,0 +1,664 @@
+//  Canny edge detection computed tile by tile, giving the same output as
+//  \doxygen{itk}{CannyEdgeDetectionImageFilter} on the whole image.
+//
+//  The Canny filter smooths the image, takes its second directional
+//  derivative along the gradient and keeps its zero crossings weighted by
+//  the gradient (the non-maximum suppression).  All of this is local: a
+//  pixel only depends on the pixels within the radius of the Gaussian
+//  kernel plus three, for the three radius 1 stencils that follow.  The
+//  last step, the hysteresis thresholding, is not: it keeps the pixels
+//  above the lower threshold that are 8-connected to a pixel above the
+//  upper threshold, and the Canny filter follows those connections with a
+//  sequential flood fill over the whole image, which prevents streaming.
+//
+//  This filter runs the Canny filter on each tile padded by a halo covering
+//  the local steps, so its non-maximum suppression matches the one over the
+//  whole image bit for bit inside the tile (the halo is cropped at the image
+//  border, where the boundary condition is then the same).  The hysteresis
+//  becomes a connected-component problem solved in two passes:
+//
+//  \begin{itemize}
+//  \item When the output information is generated, every tile is labeled
+//  with a union-find over its pixels above the lower threshold, several
+//  tiles at a time.  A component is seeded if it holds or touches a pixel
+//  above the upper threshold.  Only the components reaching the tile
+//  border are kept, as nodes of a global union-find merged across the tile
+//  borders (corners included), which propagates the seeds between tiles.
+//  \item Each requested region is then produced from the tiles overlapping
+//  it, labeled again in the same way: a pixel is an edge if it is above the
+//  upper threshold, or above the lower threshold in a seeded component.
+//  \end{itemize}
+//
+//  Memory depends on the tile size, plus the border components of all the
+//  tiles, not on the image size.  The first pass computes each tile once.
+//  The second computes every tile overlapping a requested region, for each
+//  streamed consumer of the output: a downstream filter streaming its input
+//  on its own (e.g. the statistics pass of a streaming rescale) runs it
+//  again before the writer does.  Consumers streaming on tiles other than
+//  \code{TileSize} compute the tiles they cut several times, so their
+//  streaming should be aligned on it.
+
+#ifndef TiledCannyEdgeDetectionImageFilter_h
+#define TiledCannyEdgeDetectionImageFilter_h
+
+#include "itkCannyEdgeDetectionImageFilter.h"
+#include "itkGaussianOperator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageToImageFilter.h"
+#include "itkMultiThreaderBase.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace otb {
+
+template <class TInputImage, class TOutputImage>
+class ITK_EXPORT TiledCannyEdgeDetectionImageFilter
+    : public itk::ImageToImageFilter<TInputImage, TOutputImage> {
+public:
+  using Self = TiledCannyEdgeDetectionImageFilter<TInputImage, TOutputImage>;
+  using Superclass = itk::ImageToImageFilter<TInputImage, TOutputImage>;
+  using Pointer = itk::SmartPointer<Self>;
+  using ConstPointer = itk::SmartPointer<const Self>;
+
+  /** Method for creation through object factory */
+  itkNewMacro(Self);
+
+  /** Run-time type information */
+  itkTypeMacro(TiledCannyEdgeDetectionImageFilter, itk::ImageToImageFilter);
+
+  /** Display */
+  void PrintSelf(std::ostream &os, itk::Indent indent) const override;
+
+  using CannyType =
+      itk::CannyEdgeDetectionImageFilter<TInputImage, TOutputImage>;
+  using ArrayType = typename CannyType::ArrayType;
+  using OutputPixelType = typename TOutputImage::PixelType;
+  using RegionType = typename TOutputImage::RegionType;
+  using IndexType = typename TOutputImage::IndexType;
+  using SizeType = typename TOutputImage::SizeType;
+
+  /** Parameters of the Canny filter, with the same defaults */
+  itkSetMacro(Variance, ArrayType);
+  itkGetConstMacro(Variance, ArrayType);
+  itkSetMacro(MaximumError, ArrayType);
+  itkGetConstMacro(MaximumError, ArrayType);
+  itkSetMacro(UpperThreshold, OutputPixelType);
+  itkGetConstMacro(UpperThreshold, OutputPixelType);
+  itkSetMacro(LowerThreshold, OutputPixelType);
+  itkGetConstMacro(LowerThreshold, OutputPixelType);
+
+  void SetVariance(double variance) {
+    ArrayType array;
+    array.Fill(variance);
+    this->SetVariance(array);
+  }
+  void SetMaximumError(double maximumError) {
+    ArrayType array;
+    array.Fill(maximumError);
+    this->SetMaximumError(array);
+  }
+
+  /** Size of the tiles the Canny filter runs on */
+  itkGetConstReferenceMacro(TileSize, SizeType);
+  itkSetMacro(TileSize, SizeType);
+
+protected:
+  TiledCannyEdgeDetectionImageFilter();
+  ~TiledCannyEdgeDetectionImageFilter() override = default;
+
+  void GenerateOutputInformation() override;
+  void GenerateInputRequestedRegion() override;
+  void GenerateData() override;
+
+private:
+  TiledCannyEdgeDetectionImageFilter(const Self &) = delete;
+  void operator=(const Self &) = delete;
+
+  /** Labels of the components of a tile and the pixels above the upper
+   * threshold; Labels[p] is the root pixel of the component of p, or -1 */
+  struct TileLabels {
+    long Width;
+    long Height;
+    std::vector<long> Labels;
+    std::vector<char> Strong;
+    std::vector<char> Seeded;
+  };
+
+  /** What the merge needs from a tile: the labels and strong flags along
+   * its four borders, and which of the border labels are seeded */
+  struct TileBorders {
+    std::vector<long> Top, Bottom, Left, Right;
+    std::vector<char> TopStrong, BottomStrong, LeftStrong, RightStrong;
+    std::map<long, bool> Seeded;
+  };
+
+  /** Halo needed around a tile for its non-maximum suppression to be exact */
+  SizeType ComputeHalo() const;
+
+  /** Tile of the grid, cropped to the image */
+  RegionType GetTile(long tileX, long tileY) const;
+
+  /** Copy the tile padded by the halo out of an image buffering it */
+  typename TInputImage::Pointer ExtractPaddedTile(const TInputImage *input,
+                                                  const RegionType &tile) const;
+
+  /** Run the Canny filter on a padded tile and label the tile */
+  void LabelTile(TInputImage *paddedTile, const RegionType &tile,
+                 TileLabels &labels) const;
+
+  /** Run body(k) for k in 0 .. count - 1 on the threads of the filter */
+  void ParallelFor(long count, const std::function<void(long)> &body) const;
+
+  ArrayType m_Variance;
+  ArrayType m_MaximumError;
+  OutputPixelType m_UpperThreshold;
+  OutputPixelType m_LowerThreshold;
+  SizeType m_TileSize;
+
+  // Result of the first pass: for each tile, its border labels that are
+  // seeded once the components are merged across tiles
+  long m_TilesX = 0;
+  long m_TilesY = 0;
+  std::vector<std::map<long, bool>> m_MergedSeeds;
+  itk::TimeStamp m_MergeTime;
+};
+
+} /* namespace otb */
+
+namespace otb {
+
+template <class TInputImage, class TOutputImage>
+TiledCannyEdgeDetectionImageFilter<
+    TInputImage, TOutputImage>::TiledCannyEdgeDetectionImageFilter()
+    : m_UpperThreshold(itk::NumericTraits<OutputPixelType>::ZeroValue()),
+      m_LowerThreshold(itk::NumericTraits<OutputPixelType>::ZeroValue()) {
+  m_Variance.Fill(0.0);
+  m_MaximumError.Fill(0.01);
+  m_TileSize.Fill(512);
+}
+
+//  Same kernel radius as the itk::DiscreteGaussianImageFilter inside the
+//  Canny filter, plus one for each of the three radius 1 stencils chained
+//  after it: the second directional derivative, its derivative along the
+//  gradient, and the zero crossings.  There is no margin: a smaller halo
+//  changes the non-maximum suppression near the tile borders.
+
+template <class TInputImage, class TOutputImage>
+typename TiledCannyEdgeDetectionImageFilter<TInputImage,
+                                            TOutputImage>::SizeType
+TiledCannyEdgeDetectionImageFilter<TInputImage, TOutputImage>::ComputeHalo()
+    const {
+  const typename TInputImage::SpacingType spacing =
+      this->GetInput()->GetSpacing();
+
+  SizeType halo;
+  for (unsigned int i = 0; i < TInputImage::ImageDimension; ++i) {
+    itk::GaussianOperator<double, TInputImage::ImageDimension> gaussian;
+    gaussian.SetDirection(i);
+    gaussian.SetVariance(m_Variance[i] / (spacing[i] * spacing[i]));
+    gaussian.SetMaximumError(m_MaximumError[i]);
+    gaussian.SetMaximumKernelWidth(32);
+    gaussian.CreateDirectional();
+    halo[i] = gaussian.GetRadius(i) + 3;
+  }
+  return halo;
+}
+
+template <class TInputImage, class TOutputImage>
+typename TiledCannyEdgeDetectionImageFilter<TInputImage,
+                                            TOutputImage>::RegionType
+TiledCannyEdgeDetectionImageFilter<TInputImage, TOutputImage>::GetTile(
+    long tileX, long tileY) const {
+  const RegionType largest = this->GetOutput()->GetLargestPossibleRegion();
+
+  IndexType index = largest.GetIndex();
+  index[0] += tileX * m_TileSize[0];
+  index[1] += tileY * m_TileSize[1];
+  RegionType tile(index, m_TileSize);
+  tile.Crop(largest);
+  return tile;
+}
+
+template <class TInputImage, class TOutputImage>
+typename TInputImage::Pointer
+TiledCannyEdgeDetectionImageFilter<TInputImage, TOutputImage>::
+    ExtractPaddedTile(const TInputImage *input, const RegionType &tile) const {
+  RegionType padded = tile;
+  padded.PadByRadius(this->ComputeHalo());
+  padded.Crop(input->GetLargestPossibleRegion());
+
+  // The tile image keeps the index and geometry of the input, but its
+  // largest region is the padded tile, whose border is the one the Canny
+  // filter sees
+  typename TInputImage::Pointer paddedTile = TInputImage::New();
+  paddedTile->CopyInformation(input);
+  paddedTile->SetRegions(padded);
+  paddedTile->Allocate();
+
+  itk::ImageRegionConstIterator<TInputImage> inputIt(input, padded);
+  itk::ImageRegionIterator<TInputImage> tileIt(paddedTile, padded);
+  for (inputIt.GoToBegin(), tileIt.GoToBegin(); !inputIt.IsAtEnd();
+       ++inputIt, ++tileIt) {
+    tileIt.Set(inputIt.Get());
+  }
+  return paddedTile;
+}
+
+//  The components are labeled in raster order, each root being the
+//  smallest pixel index of its component, so labeling the same tile twice
+//  gives the same labels.
+
+template <class TInputImage, class TOutputImage>
+void TiledCannyEdgeDetectionImageFilter<TInputImage, TOutputImage>::LabelTile(
+    TInputImage *paddedTile, const RegionType &tile,
+    TileLabels &labels) const {
+  typename CannyType::Pointer canny = CannyType::New();
+  canny->SetInput(paddedTile);
+  canny->SetVariance(m_Variance);
+  canny->SetMaximumError(m_MaximumError);
+  canny->SetUpperThreshold(m_UpperThreshold);
+  canny->SetLowerThreshold(m_LowerThreshold);
+  canny->SetNumberOfWorkUnits(1);
+  canny->Update();
+  const TOutputImage *strength = canny->GetNonMaximumSuppressionImage();
+
+  const long width = tile.GetSize()[0];
+  const long height = tile.GetSize()[1];
+  labels.Width = width;
+  labels.Height = height;
+  labels.Labels.assign(width * height, -1);
+  labels.Strong.assign(width * height, 0);
+  labels.Seeded.assign(width * height, 0);
+
+  std::vector<long> &parent = labels.Labels;
+  const auto find = [&parent](long p) {
+    while (parent[p] != p) {
+      parent[p] = parent[parent[p]];
+      p = parent[p];
+    }
+    return p;
+  };
+  const auto unite = [&parent, &find](long a, long b) {
+    a = find(a);
+    b = find(b);
+    if (a != b) {
+      parent[std::max(a, b)] = std::min(a, b);
+    }
+  };
+
+  itk::ImageRegionConstIterator<TOutputImage> strengthIt(strength, tile);
+  strengthIt.GoToBegin();
+  for (long y = 0; y < height; ++y) {
+    for (long x = 0; x < width; ++x, ++strengthIt) {
+      const long p = y * width + x;
+      const OutputPixelType value = strengthIt.Get();
+      labels.Strong[p] = value > m_UpperThreshold;
+      if (!(value > m_LowerThreshold)) {
+        continue;
+      }
+      parent[p] = p;
+      // Neighbors already visited: left, and the three above
+      if (x > 0 && parent[p - 1] >= 0) {
+        unite(p, p - 1);
+      }
+      if (y > 0) {
+        for (long dx = -1; dx <= 1; ++dx) {
+          const long q = p - width + dx;
+          if (x + dx >= 0 && x + dx < width && parent[q] >= 0) {
+            unite(p, q);
+          }
+        }
+      }
+    }
+  }
+  for (long p = 0; p < width * height; ++p) {
+    if (parent[p] >= 0) {
+      parent[p] = find(p);
+    }
+  }
+
+  // A strong pixel seeds its own component and the ones it touches
+  for (long y = 0; y < height; ++y) {
+    for (long x = 0; x < width; ++x) {
+      if (!labels.Strong[y * width + x]) {
+        continue;
+      }
+      for (long dy = -1; dy <= 1; ++dy) {
+        for (long dx = -1; dx <= 1; ++dx) {
+          if (x + dx >= 0 && x + dx < width && y + dy >= 0 &&
+              y + dy < height) {
+            const long label = parent[(y + dy) * width + x + dx];
+            if (label >= 0) {
+              labels.Seeded[label] = 1;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+void TiledCannyEdgeDetectionImageFilter<TInputImage, TOutputImage>::
+    ParallelFor(long count, const std::function<void(long)> &body) const {
+  const long nbThreads = std::min<long>(
+      count,
+      std::max<long>(1, this->GetMultiThreader()->GetMaximumNumberOfThreads()));
+
+  std::atomic<long> next(0);
+  std::exception_ptr error;
+  std::mutex errorMutex;
+  std::vector<std::thread> threads;
+  for (long t = 0; t < nbThreads; ++t) {
+    threads.emplace_back([&]() {
+      for (long k = next++; k < count; k = next++) {
+        try {
+          body(k);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(errorMutex);
+          error = std::current_exception();
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+//  First pass: label every tile and merge the border components.  The
+//  writer asks for the output information before requesting any region, so
+//  the merge is done before the first region is produced.  The input is
+//  pulled one padded tile at a time, and as many tiles as there are threads
+//  are labeled at once.
+
+template <class TInputImage, class TOutputImage>
+void TiledCannyEdgeDetectionImageFilter<
+    TInputImage, TOutputImage>::GenerateOutputInformation() {
+  Superclass::GenerateOutputInformation();
+
+  TInputImage *input = const_cast<TInputImage *>(this->GetInput());
+  if (!input) {
+    return;
+  }
+  if (m_MergeTime.GetMTime() > input->GetPipelineMTime() &&
+      m_MergeTime.GetMTime() > this->GetMTime()) {
+    return;
+  }
+
+  const RegionType largest = this->GetOutput()->GetLargestPossibleRegion();
+  m_TileSize[0] = std::max<itk::SizeValueType>(m_TileSize[0], 1);
+  m_TileSize[1] = std::max<itk::SizeValueType>(m_TileSize[1], 1);
+  m_TilesX = (largest.GetSize()[0] + m_TileSize[0] - 1) / m_TileSize[0];
+  m_TilesY = (largest.GetSize()[1] + m_TileSize[1] - 1) / m_TileSize[1];
+  const long nbTiles = m_TilesX * m_TilesY;
+  const long batchSize =
+      std::max<long>(1, this->GetMultiThreader()->GetMaximumNumberOfThreads());
+
+  std::vector<TileBorders> borders(nbTiles);
+  for (long first = 0; first < nbTiles; first += batchSize) {
+    const long count = std::min(batchSize, nbTiles - first);
+
+    std::vector<typename TInputImage::Pointer> paddedTiles(count);
+    for (long k = 0; k < count; ++k) {
+      const RegionType tile =
+          this->GetTile((first + k) % m_TilesX, (first + k) / m_TilesX);
+      RegionType padded = tile;
+      padded.PadByRadius(this->ComputeHalo());
+      padded.Crop(input->GetLargestPossibleRegion());
+
+      input->SetRequestedRegion(padded);
+      input->PropagateRequestedRegion();
+      input->UpdateOutputData();
+      paddedTiles[k] = this->ExtractPaddedTile(input, tile);
+    }
+
+    this->ParallelFor(count, [&](long k) {
+      const long t = first + k;
+      const RegionType tile = this->GetTile(t % m_TilesX, t / m_TilesX);
+      TileLabels labels;
+      this->LabelTile(paddedTiles[k], tile, labels);
+      paddedTiles[k] = nullptr;
+
+      const long w = labels.Width;
+      const long h = labels.Height;
+      TileBorders &border = borders[t];
+      for (long x = 0; x < w; ++x) {
+        border.Top.push_back(labels.Labels[x]);
+        border.TopStrong.push_back(labels.Strong[x]);
+        border.Bottom.push_back(labels.Labels[(h - 1) * w + x]);
+        border.BottomStrong.push_back(labels.Strong[(h - 1) * w + x]);
+      }
+      for (long y = 0; y < h; ++y) {
+        border.Left.push_back(labels.Labels[y * w]);
+        border.LeftStrong.push_back(labels.Strong[y * w]);
+        border.Right.push_back(labels.Labels[y * w + w - 1]);
+        border.RightStrong.push_back(labels.Strong[y * w + w - 1]);
+      }
+      for (const std::vector<long> *side :
+           {&border.Top, &border.Bottom, &border.Left, &border.Right}) {
+        for (long label : *side) {
+          if (label >= 0) {
+            border.Seeded[label] = labels.Seeded[label] != 0;
+          }
+        }
+      }
+    });
+  }
+
+  // Global union-find over the border components of all the tiles
+  std::vector<std::map<long, long>> nodes(nbTiles);
+  std::vector<long> parent;
+  std::vector<char> seeded;
+  for (long t = 0; t < nbTiles; ++t) {
+    for (const auto &entry : borders[t].Seeded) {
+      nodes[t][entry.first] = parent.size();
+      parent.push_back(parent.size());
+      seeded.push_back(entry.second);
+    }
+  }
+  const auto find = [&parent](long n) {
+    while (parent[n] != n) {
+      parent[n] = parent[parent[n]];
+      n = parent[n];
+    }
+    return n;
+  };
+
+  // Pixels a of tile s and b of tile u are 8-neighbors across a border:
+  // their components merge if both are above the lower threshold, and a
+  // strong pixel seeds the component it touches
+  const auto link = [&](long s, long a, char aStrong, long u, long b,
+                        char bStrong) {
+    if (a >= 0 && b >= 0) {
+      const long ra = find(nodes[s][a]);
+      const long rb = find(nodes[u][b]);
+      if (ra != rb) {
+        parent[rb] = ra;
+        seeded[ra] = seeded[ra] || seeded[rb];
+      }
+    }
+    if (aStrong && b >= 0) {
+      seeded[find(nodes[u][b])] = 1;
+    }
+    if (bStrong && a >= 0) {
+      seeded[find(nodes[s][a])] = 1;
+    }
+  };
+
+  for (long ty = 0; ty < m_TilesY; ++ty) {
+    for (long tx = 0; tx < m_TilesX; ++tx) {
+      const long s = ty * m_TilesX + tx;
+      const TileBorders &current = borders[s];
+      if (tx + 1 < m_TilesX) {
+        const TileBorders &right = borders[s + 1];
+        const long h = current.Right.size();
+        for (long y = 0; y < h; ++y) {
+          for (long dy = -1; dy <= 1; ++dy) {
+            if (y + dy >= 0 && y + dy < h) {
+              link(s, current.Right[y], current.RightStrong[y], s + 1,
+                   right.Left[y + dy], right.LeftStrong[y + dy]);
+            }
+          }
+        }
+      }
+      if (ty + 1 < m_TilesY) {
+        const long u = s + m_TilesX;
+        const TileBorders &below = borders[u];
+        const long w = current.Bottom.size();
+        for (long x = 0; x < w; ++x) {
+          for (long dx = -1; dx <= 1; ++dx) {
+            if (x + dx >= 0 && x + dx < w) {
+              link(s, current.Bottom[x], current.BottomStrong[x], u,
+                   below.Top[x + dx], below.TopStrong[x + dx]);
+            }
+          }
+        }
+        // Corners: bottom-right pixel with the top-left pixel of the tile
+        // below on the right, and bottom-left pixel with the top-right
+        // pixel of the tile below on the left
+        if (tx + 1 < m_TilesX) {
+          const TileBorders &diagonal = borders[u + 1];
+          link(s, current.Bottom.back(), current.BottomStrong.back(), u + 1,
+               diagonal.Top.front(), diagonal.TopStrong.front());
+        }
+        if (tx > 0) {
+          const TileBorders &diagonal = borders[u - 1];
+          link(s, current.Bottom.front(), current.BottomStrong.front(), u - 1,
+               diagonal.Top.back(), diagonal.TopStrong.back());
+        }
+      }
+    }
+  }
+
+  m_MergedSeeds.assign(nbTiles, std::map<long, bool>());
+  for (long t = 0; t < nbTiles; ++t) {
+    for (const auto &entry : nodes[t]) {
+      m_MergedSeeds[t][entry.first] = seeded[find(entry.second)] != 0;
+    }
+  }
+  m_MergeTime.Modified();
+}
+
+//  The tiles overlapping the requested region are all computed, so the
+//  input must cover them with their halo.
+
+template <class TInputImage, class TOutputImage>
+void TiledCannyEdgeDetectionImageFilter<
+    TInputImage, TOutputImage>::GenerateInputRequestedRegion() {
+  Superclass::GenerateInputRequestedRegion();
+
+  TInputImage *input = const_cast<TInputImage *>(this->GetInput());
+  if (!input) {
+    return;
+  }
+
+  const RegionType largest = this->GetOutput()->GetLargestPossibleRegion();
+  const RegionType requested = this->GetOutput()->GetRequestedRegion();
+
+  IndexType index;
+  SizeType size;
+  for (unsigned int i = 0; i < 2; ++i) {
+    const long first =
+        (requested.GetIndex()[i] - largest.GetIndex()[i]) / m_TileSize[i];
+    const long last = (requested.GetIndex()[i] + requested.GetSize()[i] - 1 -
+                       largest.GetIndex()[i]) /
+                      m_TileSize[i];
+    index[i] = largest.GetIndex()[i] + first * m_TileSize[i];
+    size[i] = (last - first + 1) * m_TileSize[i];
+  }
+  RegionType inputRequested(index, size);
+  inputRequested.PadByRadius(this->ComputeHalo());
+  inputRequested.Crop(input->GetLargestPossibleRegion());
+  input->SetRequestedRegion(inputRequested);
+}
+
+//  Second pass: label again the tiles overlapping the requested region and
+//  keep the pixels of the seeded components.  The tiles write disjoint
+//  parts of the output, so they are processed in parallel.
+
+template <class TInputImage, class TOutputImage>
+void TiledCannyEdgeDetectionImageFilter<TInputImage,
+                                        TOutputImage>::GenerateData() {
+  this->AllocateOutputs();
+
+  const TInputImage *input = this->GetInput();
+  TOutputImage *output = this->GetOutput();
+  const RegionType requested = output->GetRequestedRegion();
+
+  std::vector<long> tiles;
+  for (long ty = 0; ty < m_TilesY; ++ty) {
+    for (long tx = 0; tx < m_TilesX; ++tx) {
+      RegionType tile = this->GetTile(tx, ty);
+      if (tile.Crop(requested)) {
+        tiles.push_back(ty * m_TilesX + tx);
+      }
+    }
+  }
+
+  const OutputPixelType edge = itk::NumericTraits<OutputPixelType>::OneValue();
+  const OutputPixelType background =
+      itk::NumericTraits<OutputPixelType>::ZeroValue();
+
+  this->ParallelFor(tiles.size(), [&](long k) {
+    const long t = tiles[k];
+    const RegionType tile = this->GetTile(t % m_TilesX, t / m_TilesX);
+    typename TInputImage::Pointer paddedTile =
+        this->ExtractPaddedTile(input, tile);
+    TileLabels labels;
+    this->LabelTile(paddedTile, tile, labels);
+    paddedTile = nullptr;
+
+    const std::map<long, bool> &mergedSeeds = m_MergedSeeds[t];
+    RegionType part = tile;
+    part.Crop(requested);
+    itk::ImageRegionIterator<TOutputImage> outputIt(output, part);
+    for (outputIt.GoToBegin(); !outputIt.IsAtEnd(); ++outputIt) {
+      const IndexType index = outputIt.GetIndex();
+      const long p = (index[1] - tile.GetIndex()[1]) * labels.Width +
+                     index[0] - tile.GetIndex()[0];
+      const long label = labels.Labels[p];
+
+      bool isEdge = labels.Strong[p] != 0;
+      if (!isEdge && label >= 0) {
+        const auto merged = mergedSeeds.find(label);
+        isEdge = merged != mergedSeeds.end() ? merged->second
+                                             : labels.Seeded[label] != 0;
+      }
+      outputIt.Set(isEdge ? edge : background);
+    }
+  });
+}
+
+template <class TInputImage, class TOutputImage>
+void TiledCannyEdgeDetectionImageFilter<TInputImage, TOutputImage>::PrintSelf(
+    std::ostream &os, itk::Indent indent) const {
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Variance: " << this->m_Variance << std::endl;
+  os << indent << "MaximumError: " << this->m_MaximumError << std::endl;
+  os << indent << "UpperThreshold: "
+     << static_cast<typename itk::NumericTraits<OutputPixelType>::PrintType>(
+            this->m_UpperThreshold)
+     << std::endl;
+  os << indent << "LowerThreshold: "
+     << static_cast<typename itk::NumericTraits<OutputPixelType>::PrintType>(
+            this->m_LowerThreshold)
+     << std::endl;
+  os << indent << "TileSize: " << this->m_TileSize << std::endl;
+}
+
+} /* end namespace otb */
+
+#endif
@@ -4,10 +4,16 @@
 #include <cstdlib>
 #include <iostream>
 
+#include "MappedRasterImage.h"
+#include "PipelineProfiler.h"
+
 int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
   if (argc != 3) {
     std::cerr << "Usage: " << argv[0] << " <input_filename> <output_filename>"
               << std::endl;
+    return EXIT_FAILURE;
   }
 
   using ImageType = otb::VectorImage<unsigned char, 2>;
@@ -18,10 +24,24 @@ int main(int argc, char *argv[]) {
   using WriterType = otb::ImageFileWriter<ImageType>;
   WriterType::Pointer writer = WriterType::New();
 
+  // Same format and pixel type on both sides: copy the files as they are
+  if (otb::CopyRasterFiles(argv[1], argv[2],
+                           otb::GetGDALDataType<ImageType::InternalPixelType>(),
+                           0)) {
+    return EXIT_SUCCESS;
+  }
+
   reader->SetFileName(argv[1]);
   writer->SetFileName(argv[2]);
 
-  writer->SetInput(reader->GetOutput());
+  // Uncompressed input: the file pages are the image buffer, no decoding
+  otb::MappedRasterImage<ImageType> mapped(argv[1]);
+  if (mapped.IsMapped()) {
+    writer->SetInput(mapped.GetOutput());
+  } else {
+    writer->SetInput(reader->GetOutput());
+  }
+  profiler.Attach(writer);
   writer->Update();
 
   return EXIT_SUCCESS;
@@ -0,0 +1,199 @@
+//  Per-band shift and scale of a \doxygen{otb}{VectorImage}, in one pass
+//  over the interleaved buffer.
+//
+//  Wrapping \doxygen{itk}{ShiftScaleImageFilter} in
+//  \doxygen{otb}{PerBandVectorImageFilter} splits the image into one scalar
+//  image per band, runs the wrapped filter on each and assembles the
+//  results.  This filter computes the same $(x + shift_b) \times scale_b$
+//  directly on the interleaved values, with a shift and a scale per band $b$
+//  (a single value applies to every band), and saturates the result to the
+//  range of the output pixel type as \doxygen{itk}{ShiftScaleImageFilter}
+//  does, truncating like it too, so the two give the same output.
+//
+//  The shifts and scales are repeated along a block of values whose length
+//  is a multiple of the number of bands, so the inner loop runs over three
+//  contiguous arrays without any modulo and the compiler can vectorize it.
+
+#ifndef VectorShiftScaleImageFilter_h
+#define VectorShiftScaleImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkNumericTraits.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace otb {
+
+template <class TInputImage, class TOutputImage>
+class ITK_EXPORT VectorShiftScaleImageFilter
+    : public itk::ImageToImageFilter<TInputImage, TOutputImage> {
+public:
+  using Self = VectorShiftScaleImageFilter<TInputImage, TOutputImage>;
+  using Superclass = itk::ImageToImageFilter<TInputImage, TOutputImage>;
+  using Pointer = itk::SmartPointer<Self>;
+  using ConstPointer = itk::SmartPointer<const Self>;
+
+  /** Method for creation through object factory */
+  itkNewMacro(Self);
+
+  /** Run-time type information */
+  itkTypeMacro(VectorShiftScaleImageFilter, itk::ImageToImageFilter);
+
+  /** Display */
+  void PrintSelf(std::ostream &os, itk::Indent indent) const override;
+
+  using InputInternalPixelType = typename TInputImage::InternalPixelType;
+  using OutputInternalPixelType = typename TOutputImage::InternalPixelType;
+  using OutputImageRegionType = typename TOutputImage::RegionType;
+
+  /** Shift added to each band before scaling: one value per band, or a
+   * single value for all of them */
+  void SetShift(const std::vector<double> &shift) {
+    if (m_Shift != shift) {
+      m_Shift = shift;
+      this->Modified();
+    }
+  }
+  void SetShift(double shift) {
+    this->SetShift(std::vector<double>(1, shift));
+  }
+  itkGetConstReferenceMacro(Shift, std::vector<double>);
+
+  /** Factor applied to each shifted band: one value per band, or a single
+   * value for all of them */
+  void SetScale(const std::vector<double> &scale) {
+    if (m_Scale != scale) {
+      m_Scale = scale;
+      this->Modified();
+    }
+  }
+  void SetScale(double scale) {
+    this->SetScale(std::vector<double>(1, scale));
+  }
+  itkGetConstReferenceMacro(Scale, std::vector<double>);
+
+protected:
+  VectorShiftScaleImageFilter() : m_Shift(1, 0.0), m_Scale(1, 1.0) {}
+  ~VectorShiftScaleImageFilter() override = default;
+
+  void GenerateOutputInformation() override;
+  void BeforeThreadedGenerateData() override;
+  void DynamicThreadedGenerateData(
+      const OutputImageRegionType &outputRegion) override;
+
+private:
+  VectorShiftScaleImageFilter(const Self &) = delete;
+  void operator=(const Self &) = delete;
+
+  std::vector<double> m_Shift;
+  std::vector<double> m_Scale;
+
+  /** Shifts and scales repeated over a block of whole pixels */
+  std::vector<double> m_BlockShift;
+  std::vector<double> m_BlockScale;
+};
+
+} /* namespace otb */
+
+namespace otb {
+
+template <class TInputImage, class TOutputImage>
+void VectorShiftScaleImageFilter<TInputImage,
+                                 TOutputImage>::GenerateOutputInformation() {
+  Superclass::GenerateOutputInformation();
+
+  this->GetOutput()->SetNumberOfComponentsPerPixel(
+      this->GetInput()->GetNumberOfComponentsPerPixel());
+}
+
+//  The blocks hold at least 256 values, a whole number of pixels.
+
+template <class TInputImage, class TOutputImage>
+void VectorShiftScaleImageFilter<TInputImage,
+                                 TOutputImage>::BeforeThreadedGenerateData() {
+  const unsigned int nbBands =
+      this->GetInput()->GetNumberOfComponentsPerPixel();
+  if ((m_Shift.size() != 1 && m_Shift.size() != nbBands) ||
+      (m_Scale.size() != 1 && m_Scale.size() != nbBands)) {
+    itkExceptionMacro(<< m_Shift.size() << " shift(s) and " << m_Scale.size()
+                      << " scale(s) set but the input image has " << nbBands
+                      << " band(s).");
+  }
+
+  const unsigned int blockLength = (255 / nbBands + 1) * nbBands;
+  m_BlockShift.resize(blockLength);
+  m_BlockScale.resize(blockLength);
+  for (unsigned int j = 0; j < blockLength; ++j) {
+    const unsigned int band = j % nbBands;
+    m_BlockShift[j] = m_Shift[m_Shift.size() == 1 ? 0 : band];
+    m_BlockScale[j] = m_Scale[m_Scale.size() == 1 ? 0 : band];
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+void VectorShiftScaleImageFilter<TInputImage, TOutputImage>::
+    DynamicThreadedGenerateData(const OutputImageRegionType &outputRegion) {
+  const TInputImage *inputImage = this->GetInput();
+  TOutputImage *outputImage = this->GetOutput();
+
+  const unsigned int nbBands = inputImage->GetNumberOfComponentsPerPixel();
+  const double lowest = static_cast<double>(
+      itk::NumericTraits<OutputInternalPixelType>::NonpositiveMin());
+  const double highest = static_cast<double>(
+      itk::NumericTraits<OutputInternalPixelType>::max());
+
+  const long rowLength = outputRegion.GetSize()[0] * nbBands;
+  const long height = outputRegion.GetSize()[1];
+  const long inputStride =
+      inputImage->GetBufferedRegion().GetSize()[0] * nbBands;
+  const long outputStride =
+      outputImage->GetBufferedRegion().GetSize()[0] * nbBands;
+
+  const InputInternalPixelType *inputRow =
+      inputImage->GetBufferPointer() +
+      inputImage->ComputeOffset(outputRegion.GetIndex()) * nbBands;
+  OutputInternalPixelType *outputRow =
+      outputImage->GetBufferPointer() +
+      outputImage->ComputeOffset(outputRegion.GetIndex()) * nbBands;
+
+  const long blockLength = m_BlockShift.size();
+  const double *shift = m_BlockShift.data();
+  const double *scale = m_BlockScale.data();
+
+  for (long y = 0; y < height;
+       ++y, inputRow += inputStride, outputRow += outputStride) {
+    for (long start = 0; start < rowLength; start += blockLength) {
+      const long count = std::min(blockLength, rowLength - start);
+      const InputInternalPixelType *input = inputRow + start;
+      OutputInternalPixelType *output = outputRow + start;
+      for (long j = 0; j < count; ++j) {
+        const double value =
+            (static_cast<double>(input[j]) + shift[j]) * scale[j];
+        output[j] = static_cast<OutputInternalPixelType>(
+            std::min(std::max(value, lowest), highest));
+      }
+    }
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+void VectorShiftScaleImageFilter<TInputImage, TOutputImage>::PrintSelf(
+    std::ostream &os, itk::Indent indent) const {
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Shift:";
+  for (double shift : m_Shift) {
+    os << " " << shift;
+  }
+  os << std::endl;
+  os << indent << "Scale:";
+  for (double scale : m_Scale) {
+    os << " " << scale;
+  }
+  os << std::endl;
+}
+
+} /* end namespace otb */
+
+#endif
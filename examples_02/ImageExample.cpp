@@ -2,7 +2,12 @@
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
 
+#include "MappedRasterImage.h"
+#include "PipelineProfiler.h"
+
 int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
   // Check for input arguments: input file and output file
   if (argc < 3) {
     std::cerr << "Usage: " << argv[0] << " <inputImage> <outputImage>"
@@ -22,6 +27,14 @@ int main(int argc, char *argv[]) {
   typedef otb::ImageFileReader<ImageType> ReaderType;
   typedef otb::ImageFileWriter<ImageType> WriterType;
 
+  // Same format and pixel type on both sides: copy the files as they are
+  if (otb::CopyRasterFiles(inputFileName, outputFileName,
+                           otb::GetGDALDataType<PixelType>(), 1)) {
+    std::cout << "Image successfully copied to: " << outputFileName
+              << std::endl;
+    return EXIT_SUCCESS;
+  }
+
   // Instantiate Reader and Writer
   ReaderType::Pointer reader = ReaderType::New();
   WriterType::Pointer writer = WriterType::New();
@@ -30,11 +43,18 @@ int main(int argc, char *argv[]) {
   reader->SetFileName(inputFileName);
   writer->SetFileName(outputFileName);
 
-  // Connect pipeline: Reader → Writer
-  writer->SetInput(reader->GetOutput());
+  // Connect pipeline: Reader → Writer, or the mapped file pages → Writer
+  // when the input is uncompressed
+  otb::MappedRasterImage<ImageType> mapped(inputFileName);
+  if (mapped.IsMapped()) {
+    writer->SetInput(mapped.GetOutput());
+  } else {
+    writer->SetInput(reader->GetOutput());
+  }
 
   // Execute pipeline
   try {
+    profiler.Attach(writer);
     writer->Update();
     std::cout << "Image successfully read and written to: " << outputFileName
               << std::endl;
@@ -3,7 +3,11 @@
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
 
+#include "PipelineProfiler.h"
+
 int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
   if (argc < 3) {
     std::cerr << "Usage: " << argv[0] << " <inputImage> <outputImage>"
               << std::endl;
@@ -39,6 +43,7 @@ int main(int argc, char *argv[]) {
   writer->SetInput(meanFilter->GetOutput());
 
   try {
+    profiler.Attach(writer);
     writer->Update();
     std::cout << "Image successfully filtered and written to: "
               << outputFileName << std::endl;
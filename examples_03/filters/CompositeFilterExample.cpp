@@ -6,6 +6,8 @@
 #include "itkNumericTraits.h"
 #include "otbImage.h"
 
+#include "StreamingRescaleIntensityImageFilter.h"
+
 namespace otb {
 
 template <class TImageType>
@@ -32,6 +34,14 @@ public:
   itkGetMacro(Threshold, PixelType);
   itkSetMacro(Threshold, PixelType);
 
+  /** In fused mode the rescaling bounds come from a first streamed pass
+   * over the thresholded gradient, and each requested region is then
+   * computed and rescaled on its own, so no full-size intermediate image is
+   * held and the filter can be streamed. Off by default. */
+  itkGetMacro(FusedMode, bool);
+  itkSetMacro(FusedMode, bool);
+  itkBooleanMacro(FusedMode);
+
 protected:
   CompositeExampleImageFilter();
 
@@ -40,6 +50,8 @@ protected:
   using GradientType =
       itk::GradientMagnitudeImageFilter<TImageType, TImageType>;
   using RescalerType = itk::RescaleIntensityImageFilter<TImageType, TImageType>;
+  using StreamingRescalerType =
+      otb::StreamingRescaleIntensityImageFilter<TImageType, TImageType>;
 
   void GenerateData() override;
 
@@ -50,8 +62,10 @@ private:
   typename GradientType::Pointer m_GradientFilter;
   typename ThresholdType::Pointer m_ThresholdFilter;
   typename RescalerType::Pointer m_RescaleFilter;
+  typename StreamingRescalerType::Pointer m_StreamingRescaleFilter;
 
   PixelType m_Threshold;
+  bool m_FusedMode;
 };
 
 } // namespace otb
@@ -62,15 +76,22 @@ CompositeExampleImageFilter<TImageType>::CompositeExampleImageFilter() {
   m_GradientFilter = GradientType::New();
   m_ThresholdFilter = ThresholdType::New();
   m_RescaleFilter = RescalerType::New();
+  m_StreamingRescaleFilter = StreamingRescalerType::New();
 
   m_ThresholdFilter->SetInput(m_GradientFilter->GetOutput());
   m_RescaleFilter->SetInput(m_ThresholdFilter->GetOutput());
+  m_StreamingRescaleFilter->SetInput(m_ThresholdFilter->GetOutput());
 
   m_Threshold = 1;
+  m_FusedMode = false;
 
   m_RescaleFilter->SetOutputMinimum(
       itk::NumericTraits<PixelType>::NonpositiveMin());
   m_RescaleFilter->SetOutputMaximum(itk::NumericTraits<PixelType>::max());
+  m_StreamingRescaleFilter->SetOutputMinimum(
+      itk::NumericTraits<PixelType>::NonpositiveMin());
+  m_StreamingRescaleFilter->SetOutputMaximum(
+      itk::NumericTraits<PixelType>::max());
 }
 
 template <class TImageType>
@@ -78,10 +99,19 @@ void CompositeExampleImageFilter<TImageType>::GenerateData() {
   m_GradientFilter->SetInput(this->GetInput());
   m_ThresholdFilter->ThresholdBelow(this->m_Threshold);
 
-  m_RescaleFilter->GraftOutput(this->GetOutput());
-  m_RescaleFilter->Update();
+  if (!m_FusedMode) {
+    m_RescaleFilter->GraftOutput(this->GetOutput());
+    m_RescaleFilter->Update();
 
-  this->GraftOutput(m_RescaleFilter->GetOutput());
+    this->GraftOutput(m_RescaleFilter->GetOutput());
+    return;
+  }
+
+  // The streaming rescaler runs its min/max pass over the thresholded
+  // gradient once, then computes and rescales the requested region only
+  m_StreamingRescaleFilter->GraftOutput(this->GetOutput());
+  m_StreamingRescaleFilter->Update();
+  this->GraftOutput(m_StreamingRescaleFilter->GetOutput());
 }
 
 template <class TImageType>
@@ -90,6 +120,7 @@ void CompositeExampleImageFilter<TImageType>::PrintSelf(
   Superclass::PrintSelf(os, indent);
 
   os << indent << "Threshold: " << this->m_Threshold << std::endl;
+  os << indent << "FusedMode: " << this->m_FusedMode << std::endl;
 }
 
 } // namespace otb
@@ -97,10 +128,15 @@ void CompositeExampleImageFilter<TImageType>::PrintSelf(
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
 
+#include "PipelineProfiler.h"
+
 int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
   if (argc < 3) {
     std::cerr << "Usage: " << std::endl;
-    std::cerr << argv[0] << " inputImageFile outputImageFile" << std::endl;
+    std::cerr << argv[0] << " inputImageFile outputImageFile [fused]"
+              << std::endl;
     return -1;
   }
 
@@ -117,10 +153,12 @@ int main(int argc, char *argv[]) {
   reader->SetFileName(argv[1]);
   filter->SetInput(reader->GetOutput());
   filter->SetThreshold(20);
+  filter->SetFusedMode(argc > 3 && std::string(argv[3]) == "fused");
   writer->SetInput(filter->GetOutput());
   writer->SetFileName(argv[2]);
 
   try {
+    profiler.Attach(writer);
     writer->Update();
   } catch (itk::ExceptionObject &e) {
     std::cerr << "Error: " << e << std::endl;
@@ -2,6 +2,9 @@
 #include "itkImageToImageFilter.h"
 #include "otbImage.h"
 
+#include <algorithm>
+#include <vector>
+
 template <typename TImageType>
 class CustomFilter : public itk::ImageToImageFilter<TImageType, TImageType> {
 public:
@@ -23,33 +26,72 @@ public:
   itkSetMacro(Radius, unsigned int);
   itkGetMacro(Radius, unsigned int);
 
+  /** Compute the box mean from a summed-area table (integral image) instead
+   * of scanning the whole window, so the cost per pixel does not depend on
+   * the radius. Off by default. */
+  itkSetMacro(UseIntegralImage, bool);
+  itkGetMacro(UseIntegralImage, bool);
+  itkBooleanMacro(UseIntegralImage);
+
+  /** Use Kahan-compensated accumulation when building the summed-area
+   * table. Only meaningful when UseIntegralImage is on. */
+  itkSetMacro(UseKahanSummation, bool);
+  itkGetMacro(UseKahanSummation, bool);
+  itkBooleanMacro(UseKahanSummation);
+
 protected:
-  CustomFilter() : m_Radius(1) {}
+  CustomFilter()
+      : m_Radius(1), m_UseIntegralImage(false), m_UseKahanSummation(false) {}
   ~CustomFilter() override = default;
 
-  /** Main processing method */
-  void GenerateData() override {
-    // Get input and output images
-    typename TImageType::ConstPointer inputImage = this->GetInput();
-    ImagePointer outputImage = this->GetOutput();
+  /** The mean at a pixel needs its neighbors up to the radius, so pad the
+   * input requested region accordingly. This lets the writer stream the
+   * filter tile by tile. */
+  void GenerateInputRequestedRegion() override {
+    Superclass::GenerateInputRequestedRegion();
+
+    TImageType *inputImage = const_cast<TImageType *>(this->GetInput());
+    if (!inputImage) {
+      return;
+    }
+
+    RegionType inputRequestedRegion = inputImage->GetRequestedRegion();
+    inputRequestedRegion.PadByRadius(m_Radius);
+
+    if (inputRequestedRegion.Crop(inputImage->GetLargestPossibleRegion())) {
+      inputImage->SetRequestedRegion(inputRequestedRegion);
+      return;
+    }
+
+    // The requested region lies outside the largest possible region
+    inputImage->SetRequestedRegion(inputRequestedRegion);
+    itk::InvalidRequestedRegionError e(__FILE__, __LINE__);
+    e.SetLocation(ITK_LOCATION);
+    e.SetDescription("Requested region is (at least partially) outside the "
+                     "largest possible region.");
+    e.SetDataObject(inputImage);
+    throw e;
+  }
 
-    outputImage->SetRegions(inputImage->GetLargestPossibleRegion());
-    outputImage->Allocate();
-    outputImage->FillBuffer(0);
+  /** Main processing method, called concurrently on disjoint pieces of the
+   * output requested region */
+  void DynamicThreadedGenerateData(const RegionType &outputRegion) override {
+    const TImageType *inputImage = this->GetInput();
+    TImageType *outputImage = this->GetOutput();
 
-    // Define iterators
-    itk::ImageRegionConstIterator<TImageType> inputIt(
-        inputImage, inputImage->GetLargestPossibleRegion());
-    itk::ImageRegionIterator<TImageType> outputIt(
-        outputImage, outputImage->GetLargestPossibleRegion());
+    if (m_UseIntegralImage) {
+      this->GenerateDataFromIntegralImage(inputImage, outputImage,
+                                          outputRegion);
+      return;
+    }
 
-    SizeType radius;
-    radius.Fill(m_Radius);
+    const RegionType largestRegion = inputImage->GetLargestPossibleRegion();
+
+    itk::ImageRegionIterator<TImageType> outputIt(outputImage, outputRegion);
 
     // Process each pixel
-    for (inputIt.GoToBegin(), outputIt.GoToBegin(); !inputIt.IsAtEnd();
-         ++inputIt, ++outputIt) {
-      IndexType centerIndex = inputIt.GetIndex();
+    for (outputIt.GoToBegin(); !outputIt.IsAtEnd(); ++outputIt) {
+      IndexType centerIndex = outputIt.GetIndex();
       PixelType sum = 0;
       unsigned int count = 0;
 
@@ -62,7 +104,7 @@ protected:
           neighborIndex[0] += dx;
           neighborIndex[1] += dy;
 
-          if (inputImage->GetLargestPossibleRegion().IsInside(neighborIndex)) {
+          if (largestRegion.IsInside(neighborIndex)) {
             sum += inputImage->GetPixel(neighborIndex);
             ++count;
           }
@@ -74,9 +116,91 @@ protected:
     }
   }
 
+  /** Box mean computed from a summed-area table accumulated in double. The
+   * table only covers the output region padded by the radius (and clipped to
+   * the image), so each thread builds its own small table and memory stays
+   * bounded by the tile size. The window is clipped to the image, so border
+   * pixels are averaged over their in-image neighbors only, as in the
+   * brute-force path. */
+  void GenerateDataFromIntegralImage(const TImageType *inputImage,
+                                     TImageType *outputImage,
+                                     const RegionType &outputRegion) {
+    const RegionType largestRegion = inputImage->GetLargestPossibleRegion();
+    const long radius = static_cast<long>(m_Radius);
+
+    RegionType tableRegion = outputRegion;
+    tableRegion.PadByRadius(m_Radius);
+    tableRegion.Crop(largestRegion);
+
+    const IndexType tableIndex = tableRegion.GetIndex();
+    const long width = tableRegion.GetSize()[0];
+    const long height = tableRegion.GetSize()[1];
+    const long stride = width + 1;
+
+    // table[(y + 1) * stride + (x + 1)] holds the sum of the pixels in
+    // [0, x] x [0, y] relative to tableIndex; the leading row and column of
+    // zeros avoid border tests
+    std::vector<double> table(stride * (height + 1), 0.0);
+    std::vector<double> columnCompensation(m_UseKahanSummation ? width : 0,
+                                           0.0);
+
+    itk::ImageRegionConstIterator<TImageType> inputIt(inputImage, tableRegion);
+    inputIt.GoToBegin();
+    for (long y = 0; y < height; ++y) {
+      const double *above = &table[y * stride + 1];
+      double *current = &table[(y + 1) * stride + 1];
+      double rowSum = 0.0;
+      double rowCompensation = 0.0;
+
+      for (long x = 0; x < width; ++x, ++inputIt) {
+        const double value = static_cast<double>(inputIt.Get());
+        if (m_UseKahanSummation) {
+          const double rowTerm = value - rowCompensation;
+          const double newRowSum = rowSum + rowTerm;
+          rowCompensation = (newRowSum - rowSum) - rowTerm;
+          rowSum = newRowSum;
+
+          const double columnTerm = rowSum - columnCompensation[x];
+          current[x] = above[x] + columnTerm;
+          columnCompensation[x] = (current[x] - above[x]) - columnTerm;
+        } else {
+          rowSum += value;
+          current[x] = above[x] + rowSum;
+        }
+      }
+    }
+
+    // The table is the padded output region clipped to the image, so
+    // clipping the window to the table clips it to the image
+    const long outputX = outputRegion.GetIndex()[0] - tableIndex[0];
+    const long outputY = outputRegion.GetIndex()[1] - tableIndex[1];
+    const long outputWidth = outputRegion.GetSize()[0];
+    const long outputHeight = outputRegion.GetSize()[1];
+
+    // Each output pixel is the difference of four table entries
+    itk::ImageRegionIterator<TImageType> outputIt(outputImage, outputRegion);
+    outputIt.GoToBegin();
+    for (long y = outputY; y < outputY + outputHeight; ++y) {
+      const long y0 = std::max(y - radius, 0L);
+      const long y1 = std::min(y + radius, height - 1);
+      const double *top = &table[y0 * stride];
+      const double *bottom = &table[(y1 + 1) * stride];
+
+      for (long x = outputX; x < outputX + outputWidth; ++x, ++outputIt) {
+        const long x0 = std::max(x - radius, 0L);
+        const long x1 = std::min(x + radius, width - 1);
+        const double sum = bottom[x1 + 1] - bottom[x0] - top[x1 + 1] + top[x0];
+        const double count = static_cast<double>((x1 - x0 + 1) * (y1 - y0 + 1));
+        outputIt.Set(static_cast<PixelType>(sum / count));
+      }
+    }
+  }
+
 private:
   CustomFilter(const Self &) = delete;
   void operator=(const Self &) = delete;
 
   unsigned int m_Radius;
+  bool m_UseIntegralImage;
+  bool m_UseKahanSummation;
 };
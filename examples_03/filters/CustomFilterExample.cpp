@@ -4,15 +4,21 @@
 
 #include "CustomFilter.h"
 
+#include "PipelineProfiler.h"
+
 int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
   if (argc < 4) {
-    std::cerr << "Usage: " << argv[0] << "<inputImage> <outputImage> <radius>"
+    std::cerr << "Usage: " << argv[0]
+              << " <inputImage> <outputImage> <radius> [brute|integral|kahan]"
               << std::endl;
     return -1;
   }
   const char *inputFileName = argv[1];
   const char *outputFileName = argv[2];
   unsigned int radius = std::stoi(argv[3]);
+  const std::string mode = (argc > 4) ? argv[4] : "brute";
 
   // Define Image type
   typedef float PixelType;
@@ -34,11 +40,16 @@ int main(int argc, char *argv[]) {
   // Set radius for the custom filter
   customFilter->SetRadius(radius);
 
+  // The summed-area table modes make the cost independent of the radius
+  customFilter->SetUseIntegralImage(mode == "integral" || mode == "kahan");
+  customFilter->SetUseKahanSummation(mode == "kahan");
+
   // Connect the pipeline
   customFilter->SetInput(reader->GetOutput());
   writer->SetInput(customFilter->GetOutput());
 
   try {
+    profiler.Attach(writer);
     writer->Update();
     std::cout << "Custom filter applied and output written to: "
               << outputFileName << std::endl;
@@ -4,11 +4,15 @@
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
 
+#include "PipelineProfiler.h"
+
 constexpr unsigned int Dimension = 2;
 using PixelType = float;
 using ImageType = otb::Image<PixelType, Dimension>;
 
 int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
   if (argc < 3) {
     std::cerr << "Usage: " << argv[0] << " <inputImage> <outputImage> [radius]"
               << std::endl;
@@ -30,6 +34,7 @@ int main(int argc, char *argv[]) {
   writer->SetFileName(outputFileName);
 
   // 2. Read the input image
+  profiler.Attach(reader);
   reader->Update();
   ImageType::Pointer inputImage = reader->GetOutput();
 
@@ -68,6 +73,7 @@ int main(int argc, char *argv[]) {
   // 6. Write the output image
   writer->SetInput(outputImage);
   try {
+    profiler.Attach(writer);
     writer->Update();
     std::cout << "Neightborhood mean filter applied successfully." << std::endl;
   } catch (itk::ExceptionObject &err) {
@@ -0,0 +1,194 @@
+//  Pixel-wise filter handing whole spans of contiguous pixels to its functor.
+//
+//  \doxygen{itk}{UnaryFunctorImageFilter} calls \code{functor(pixel)} once
+//  per pixel through region iterators, so even a simple functor cannot be
+//  vectorized across pixels.  This filter calls
+//  \code{functor(const TInput *in, TOutput *out, size_t n)} instead, once per
+//  row (along the first dimension, for images of any dimension) of the
+//  region of each work unit, or once for the whole region when its rows are
+//  contiguous in both buffers; the functor can then run a SIMD loop over the
+//  span.  Functors that only have the per-pixel
+//  \code{TOutput operator()(const TInput \&)} of
+//  \doxygen{itk}{UnaryFunctorImageFilter} are adapted automatically with a
+//  loop over the span, so both kinds can be used:
+//
+//  \begin{verbatim}
+//  struct Square {
+//    float operator()(const float &x) const { return x * x; }
+//    bool operator!=(const Square &) const { return false; }
+//  };
+//  using FilterType = otb::SpanFunctorImageFilter<ImageType, ImageType,
+//                                                 Square>;
+//  \end{verbatim}
+//
+//  As with \doxygen{itk}{UnaryFunctorImageFilter}, the functor is shared by
+//  the work units and must be callable concurrently.  The images must have
+//  scalar pixels stored contiguously (\doxygen{otb}{Image}).
+
+#ifndef SpanFunctorImageFilter_h
+#define SpanFunctorImageFilter_h
+
+#include "itkImageToImageFilter.h"
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace otb {
+
+namespace SpanFunctor {
+
+/** True if TFunctor transforms spans, i.e. has an
+ * operator()(const TInput *, TOutput *, size_t) */
+template <class TFunctor, class TInput, class TOutput, class = void>
+struct IsSpanFunctor : std::false_type {};
+
+template <class TFunctor, class TInput, class TOutput>
+struct IsSpanFunctor<
+    TFunctor, TInput, TOutput,
+    decltype(void(std::declval<const TFunctor &>()(
+        std::declval<const TInput *>(), std::declval<TOutput *>(),
+        std::declval<std::size_t>())))> : std::true_type {};
+
+/** Apply a functor to n contiguous pixels, directly or pixel by pixel */
+template <class TFunctor, class TInput, class TOutput,
+          bool IsSpan = IsSpanFunctor<TFunctor, TInput, TOutput>::value>
+struct Adaptor {
+  static void Apply(const TFunctor &functor, const TInput *in, TOutput *out,
+                    std::size_t n) {
+    functor(in, out, n);
+  }
+};
+
+template <class TFunctor, class TInput, class TOutput>
+struct Adaptor<TFunctor, TInput, TOutput, false> {
+  static void Apply(const TFunctor &functor, const TInput *in, TOutput *out,
+                    std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+      out[i] = static_cast<TOutput>(functor(in[i]));
+    }
+  }
+};
+
+} // namespace SpanFunctor
+
+template <class TInputImage, class TOutputImage, class TFunctor>
+class ITK_EXPORT SpanFunctorImageFilter
+    : public itk::ImageToImageFilter<TInputImage, TOutputImage> {
+public:
+  using Self = SpanFunctorImageFilter<TInputImage, TOutputImage, TFunctor>;
+  using Superclass = itk::ImageToImageFilter<TInputImage, TOutputImage>;
+  using Pointer = itk::SmartPointer<Self>;
+  using ConstPointer = itk::SmartPointer<const Self>;
+
+  /** Method for creation through object factory */
+  itkNewMacro(Self);
+
+  /** Run-time type information */
+  itkTypeMacro(SpanFunctorImageFilter, itk::ImageToImageFilter);
+
+  using InputPixelType = typename TInputImage::PixelType;
+  using OutputPixelType = typename TOutputImage::PixelType;
+  using OutputImageRegionType = typename TOutputImage::RegionType;
+  using FunctorType = TFunctor;
+
+  /** True if the functor transforms spans itself, false if it is applied
+   * pixel by pixel */
+  static constexpr bool IsSpanFunctor =
+      SpanFunctor::IsSpanFunctor<TFunctor, InputPixelType,
+                                 OutputPixelType>::value;
+
+  /** Get the functor; the filter is not marked as modified when it is
+   * changed through this reference, call Modified() or SetFunctor() */
+  FunctorType &GetFunctor() { return m_Functor; }
+  const FunctorType &GetFunctor() const { return m_Functor; }
+
+  /** Set the functor, marking the filter as modified if it changed */
+  void SetFunctor(const FunctorType &functor) {
+    if (m_Functor != functor) {
+      m_Functor = functor;
+      this->Modified();
+    }
+  }
+
+protected:
+  SpanFunctorImageFilter() = default;
+  ~SpanFunctorImageFilter() override = default;
+
+  void DynamicThreadedGenerateData(
+      const OutputImageRegionType &outputRegion) override;
+
+private:
+  SpanFunctorImageFilter(const Self &) = delete;
+  void operator=(const Self &) = delete;
+
+  FunctorType m_Functor;
+};
+
+} /* namespace otb */
+
+namespace otb {
+
+//  A row of the region, along the first dimension, is contiguous in both
+//  buffers; the rows are visited in buffer order over all the other
+//  dimensions, so images of any dimension are processed.  When the region
+//  spans the whole buffered extent of both images along every dimension but
+//  the last, all its rows follow each other and make a single span.
+
+template <class TInputImage, class TOutputImage, class TFunctor>
+void SpanFunctorImageFilter<TInputImage, TOutputImage, TFunctor>::
+    DynamicThreadedGenerateData(const OutputImageRegionType &outputRegion) {
+  using AdaptorType =
+      SpanFunctor::Adaptor<TFunctor, InputPixelType, OutputPixelType>;
+  constexpr unsigned int Dimension = TOutputImage::ImageDimension;
+
+  const TInputImage *inputImage = this->GetInput();
+  TOutputImage *outputImage = this->GetOutput();
+
+  const std::size_t numberOfPixels = outputRegion.GetNumberOfPixels();
+  const std::size_t width = outputRegion.GetSize()[0];
+  if (numberOfPixels == 0) {
+    return;
+  }
+
+  const InputPixelType *inputBuffer = inputImage->GetBufferPointer();
+  OutputPixelType *outputBuffer = outputImage->GetBufferPointer();
+  const typename OutputImageRegionType::IndexType start =
+      outputRegion.GetIndex();
+  const typename OutputImageRegionType::SizeType size = outputRegion.GetSize();
+
+  bool contiguous = true;
+  for (unsigned int i = 0; i + 1 < Dimension; ++i) {
+    contiguous = contiguous &&
+                 size[i] == inputImage->GetBufferedRegion().GetSize()[i] &&
+                 size[i] == outputImage->GetBufferedRegion().GetSize()[i];
+  }
+  if (contiguous) {
+    AdaptorType::Apply(m_Functor,
+                       inputBuffer + inputImage->ComputeOffset(start),
+                       outputBuffer + outputImage->ComputeOffset(start),
+                       numberOfPixels);
+    return;
+  }
+
+  typename OutputImageRegionType::IndexType index = start;
+  const std::size_t numberOfRows = numberOfPixels / width;
+  for (std::size_t row = 0; row < numberOfRows; ++row) {
+    AdaptorType::Apply(m_Functor,
+                       inputBuffer + inputImage->ComputeOffset(index),
+                       outputBuffer + outputImage->ComputeOffset(index),
+                       width);
+
+    // Next row: increment the index along dimensions 1 .. Dimension - 1
+    for (unsigned int i = 1; i < Dimension; ++i) {
+      if (++index[i] < start[i] + static_cast<long>(size[i])) {
+        break;
+      }
+      index[i] = start[i];
+    }
+  }
+}
+
+} /* end namespace otb */
+
+#endif
@@ -0,0 +1,182 @@
+#include "otbImageFileWriter.h"
+#include "otbVectorImage.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TiledRasterCache.h"
+
+// Long-running chip extraction: the windows of the ImageRegionIterator
+// example, served from rasters kept open and from a cache of decoded tiles
+// shared by the worker threads.
+//
+// Requests are read from the standard input, one per line:
+//   inputImageFile outputImageFile startX startY sizeX sizeY
+// and each one is answered on the standard output, in completion order, by
+// "ok outputImageFile" or "error outputImageFile: message".  The service
+// stops at the end of the input.
+
+const unsigned int Dimension = 2;
+
+using PixelType = double;
+using ImageType = otb::VectorImage<PixelType, Dimension>;
+using CacheType = otb::TiledRasterCache<PixelType>;
+
+struct Request {
+  std::string InputFileName;
+  std::string OutputFileName;
+  long StartX, StartY, SizeX, SizeY;
+};
+
+// Writes one chip: the window is assembled by the cache, directly in the
+// buffer of the output image
+void ServeRequest(CacheType &cache, const Request &request) {
+  const CacheType::RasterInfo info = cache.GetRasterInfo(request.InputFileName);
+
+  ImageType::RegionType region;
+  region.SetSize({{static_cast<unsigned long>(request.SizeX),
+                   static_cast<unsigned long>(request.SizeY)}});
+
+  // Same convention as the GDAL image IO: the origin is the center of the
+  // first pixel of the window
+  const double *transform = info.GeoTransform;
+  ImageType::PointType origin;
+  origin[0] = transform[0] + (request.StartX + 0.5) * transform[1];
+  origin[1] = transform[3] + (request.StartY + 0.5) * transform[5];
+  ImageType::SpacingType spacing;
+  spacing[0] = transform[1];
+  spacing[1] = transform[5];
+
+  ImageType::Pointer chip = ImageType::New();
+  chip->SetRegions(region);
+  chip->SetNumberOfComponentsPerPixel(info.NbBands);
+  chip->SetOrigin(origin);
+  chip->SetSignedSpacing(spacing);
+  if (!info.ProjectionRef.empty()) {
+    chip->SetProjectionRef(info.ProjectionRef);
+  }
+  chip->Allocate();
+
+  cache.Read(request.InputFileName, request.StartX, request.StartY,
+             request.SizeX, request.SizeY, chip->GetBufferPointer());
+
+  using WriterType = otb::ImageFileWriter<ImageType>;
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetFileName(request.OutputFileName);
+  writer->SetInput(chip);
+  writer->Update();
+}
+
+int main(int argc, char *argv[]) {
+  unsigned int nbThreads = std::max(1u, std::thread::hardware_concurrency());
+  size_t cacheMiB = 1024;
+  long tileSize = 256;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string argument = argv[i];
+    if (argument == "--threads" && i + 1 < argc) {
+      nbThreads = std::max(1, ::atoi(argv[++i]));
+    } else if (argument == "--cache-mib" && i + 1 < argc) {
+      cacheMiB = ::atol(argv[++i]);
+    } else if (argument == "--tile-size" && i + 1 < argc) {
+      tileSize = ::atol(argv[++i]);
+    } else {
+      std::cerr << "Usage: " << argv[0]
+                << " [--threads N] [--cache-mib M] [--tile-size S]"
+                << std::endl;
+      std::cerr << "  then one \"inputImageFile outputImageFile startX startY "
+                   "sizeX sizeY\" request per line on the standard input"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  CacheType cache(cacheMiB << 20, tileSize);
+
+  std::mutex mutex;
+  std::condition_variable available;
+  std::deque<Request> queue;
+  bool done = false;
+  unsigned long failures = 0;
+
+  // Each worker writes its chips one at a time; the parallelism is across
+  // requests, not within a chip
+  std::vector<std::thread> workers;
+  for (unsigned int t = 0; t < nbThreads; ++t) {
+    workers.emplace_back([&]() {
+      for (;;) {
+        Request request;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          available.wait(lock, [&]() { return done || !queue.empty(); });
+          if (queue.empty()) {
+            return;
+          }
+          request = queue.front();
+          queue.pop_front();
+        }
+
+        std::string error;
+        try {
+          ServeRequest(cache, request);
+        } catch (itk::ExceptionObject &err) {
+          error = err.GetDescription();
+        } catch (std::exception &err) {
+          error = err.what();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error.empty()) {
+          std::cout << "ok " << request.OutputFileName << std::endl;
+        } else {
+          ++failures;
+          std::cout << "error " << request.OutputFileName << ": " << error
+                    << std::endl;
+        }
+      }
+    });
+  }
+
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    std::istringstream fields(line);
+    Request request;
+    if (!(fields >> request.InputFileName >> request.OutputFileName >>
+          request.StartX >> request.StartY >> request.SizeX >>
+          request.SizeY)) {
+      if (!line.empty()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++failures;
+        std::cout << "error malformed request: " << line << std::endl;
+      }
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      queue.push_back(request);
+    }
+    available.notify_one();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+  }
+  available.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+
+  std::cerr << "Tile cache: " << cache.GetHits() << " hits, "
+            << cache.GetMisses() << " misses, "
+            << (cache.GetMemoryUsage() >> 20) << " MiB in use" << std::endl;
+
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,103 +1,171 @@
-#include "itkImageRegionIterator.h"
 #include "otbImage.h"
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "gdal.h"
+
+#include "PipelineProfiler.h"
+#include "RegionExtractionImageFilter.h"
+
+const unsigned int Dimension = 2;
+
+using PixelType = double;
+using ImageType = otb::Image<PixelType, Dimension>;
+
+// One chip of a batch: its window and its position in the list, which names
+// the output file whatever the order the chips are extracted in
+struct Chip {
+  ImageType::RegionType Region;
+  unsigned int Number;
+};
+
+// Output file name of a chip: the template with "_<number>" before the
+// extension
+std::string ChipFileName(const std::string &fileTemplate, unsigned int number) {
+  std::string::size_type dot = fileTemplate.find_last_of('.');
+  const std::string::size_type slash = fileTemplate.find_last_of("/\\");
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    dot = fileTemplate.size();
+  }
+  return fileTemplate.substr(0, dot) + "_" + std::to_string(number) +
+         fileTemplate.substr(dot);
+}
+
+// Extraction in file block order: the chips are sorted by the block (tile,
+// or strip) holding their first pixel, so chips sharing blocks are extracted
+// one after the other and find them in GDAL's block cache instead of
+// decoding them again
+void SortByBlock(const std::string &fileName, std::vector<Chip> &chips) {
+  GDALAllRegister();
+  GDALDatasetH dataset = GDALOpen(fileName.c_str(), GA_ReadOnly);
+  if (!dataset) {
+    return;
+  }
+  int blockWidth = 1;
+  int blockHeight = 1;
+  GDALGetBlockSize(GDALGetRasterBand(dataset, 1), &blockWidth, &blockHeight);
+  GDALClose(dataset);
+
+  const auto key = [blockWidth, blockHeight](const Chip &chip) {
+    const ImageType::IndexType &index = chip.Region.GetIndex();
+    return std::make_tuple(index[1] / blockHeight, index[0] / blockWidth,
+                           index[1], index[0]);
+  };
+  std::stable_sort(chips.begin(), chips.end(),
+                   [&key](const Chip &a, const Chip &b) {
+                     return key(a) < key(b);
+                   });
+}
 
 int main(int argc, char *argv[]) {
-  if (argc < 7) {
+  otb::PipelineProfiler profiler(argc, argv);
+
+  const bool batch = argc == 5 && std::string(argv[2]) == "--batch";
+  if (argc < 7 && !batch) {
     std::cerr << "Missing parameters. " << std::endl;
     std::cerr << "Usage: " << std::endl;
     std::cerr << argv[0]
               << " inputImageFile outputImageFile startX startY sizeX sizeY"
               << std::endl;
+    std::cerr << argv[0]
+              << " inputImageFile --batch roiListFile outputImageFile"
+              << std::endl;
+    std::cerr << "  roiListFile holds one \"startX startY sizeX sizeY\" per "
+                 "line; chip k is written to outputImageFile with \"_k\" "
+                 "inserted before the extension"
+              << std::endl;
     return -1;
   }
 
-  const unsigned int Dimension = 2;
-
-  using PixelType = double;
-  using ImageType = otb::Image<PixelType, Dimension>;
-
-  using ConstIteratorType = itk::ImageRegionConstIterator<ImageType>;
-  using IteratorType = itk::ImageRegionIterator<ImageType>;
-
   using ReaderType = otb::ImageFileReader<ImageType>;
+  using ExtractorType = otb::RegionExtractionImageFilter<ImageType>;
   using WriterType = otb::ImageFileWriter<ImageType>;
 
-  ImageType::RegionType inputRegion;
-  ImageType::RegionType::IndexType inputStart;
-  ImageType::RegionType::SizeType size;
-
-  inputStart[0] = ::atoi(argv[3]);
-  inputStart[1] = ::atoi(argv[4]);
-
-  size[0] = ::atoi(argv[5]);
-  size[1] = ::atoi(argv[6]);
-
-  inputRegion.SetSize(size);
-  inputRegion.SetIndex(inputStart);
-
-  ImageType::RegionType outputRegion;
-  ImageType::RegionType::IndexType outputStart;
-
-  outputStart[0] = 0;
-  outputStart[1] = 0;
-
-  outputRegion.SetSize(size);
-  outputRegion.SetIndex(outputStart);
+  // In a batch, a chip that fails or a line that cannot be read is reported
+  // and the others still go
+  int status = 0;
+
+  std::vector<Chip> chips;
+  if (batch) {
+    std::ifstream list(argv[3]);
+    if (!list) {
+      std::cerr << "Cannot read the region list " << argv[3] << std::endl;
+      return -1;
+    }
+    std::string line;
+    for (unsigned long lineNumber = 1; std::getline(list, line);
+         ++lineNumber) {
+      if (line.find_first_not_of(" \t\r") == std::string::npos) {
+        continue;
+      }
+      std::istringstream fields(line);
+      long startX, startY;
+      unsigned long sizeX, sizeY;
+      if (!(fields >> startX >> startY >> sizeX >> sizeY)) {
+        std::cerr << argv[3] << ":" << lineNumber
+                  << ": skipped, expected \"startX startY sizeX sizeY\""
+                  << std::endl;
+        status = -1;
+        continue;
+      }
+      Chip chip;
+      chip.Region.SetIndex({{startX, startY}});
+      chip.Region.SetSize({{sizeX, sizeY}});
+      chip.Number = chips.size();
+      chips.push_back(chip);
+    }
+    if (chips.empty()) {
+      std::cerr << "No region in the region list " << argv[3] << std::endl;
+      return -1;
+    }
+    SortByBlock(argv[1], chips);
+  } else {
+    ImageType::RegionType inputRegion;
+    ImageType::RegionType::IndexType inputStart;
+    ImageType::RegionType::SizeType size;
+
+    inputStart[0] = ::atoi(argv[3]);
+    inputStart[1] = ::atoi(argv[4]);
+
+    size[0] = ::atoi(argv[5]);
+    size[1] = ::atoi(argv[6]);
+
+    inputRegion.SetSize(size);
+    inputRegion.SetIndex(inputStart);
+    chips.push_back({inputRegion, 0});
+  }
 
+  // The reader only decodes what the extractor requests: the window, and
+  // nothing more
   ReaderType::Pointer reader = ReaderType::New();
   reader->SetFileName(argv[1]);
-  try {
-    reader->Update();
-  } catch (itk::ExceptionObject &err) {
-    std::cerr << "ExceptionObject caught!" << std::endl;
-    std::cerr << err << std::endl;
-    return -1;
-  }
-
-  if (!reader->GetOutput()->GetRequestedRegion().IsInside(inputRegion)) {
-    std::cerr << "Error" << std::endl;
-    std::cerr << "The region " << inputRegion
-              << "is not contained within the input image region " << std::endl;
-    return -1;
-  }
 
-  ImageType::Pointer outputImage = ImageType::New();
-  outputImage->SetRegions(outputRegion);
-  const ImageType::SpacingType &spacing =
-      reader->GetOutput()->GetSignedSpacing();
-  const ImageType::PointType &inputOrigin = reader->GetOutput()->GetOrigin();
-  double outputOrigin[Dimension];
-
-  for (unsigned int i = 0; i < Dimension; i++) {
-    outputOrigin[i] = inputOrigin[i] + spacing[i] * inputStart[i];
-  }
-
-  outputImage->SetSignedSpacing(spacing);
-  outputImage->SetOrigin(outputOrigin);
-  outputImage->Allocate();
-
-  ConstIteratorType inputIt(reader->GetOutput(), inputRegion);
-  IteratorType outputIt(outputImage, outputRegion);
-
-  for (inputIt.GoToBegin(), outputIt.GoToBegin(); !inputIt.IsAtEnd();
-       ++inputIt, ++outputIt) {
-    outputIt.Set(inputIt.Get());
-  }
+  ExtractorType::Pointer extractor = ExtractorType::New();
+  extractor->SetInput(reader->GetOutput());
 
   WriterType::Pointer writer = WriterType::New();
-  writer->SetFileName(argv[2]);
-  writer->SetInput(outputImage);
-
-  try {
-    writer->Update();
-  } catch (itk::ExceptionObject &err) {
-    std::cerr << "ExceptionObject caught!" << std::endl;
-    std::cerr << err << std::endl;
-    return -1;
+  writer->SetInput(extractor->GetOutput());
+  profiler.Attach(writer);
+
+  for (const Chip &chip : chips) {
+    extractor->SetRegionOfInterest(chip.Region);
+    writer->SetFileName(batch ? ChipFileName(argv[4], chip.Number) : argv[2]);
+
+    try {
+      writer->Update();
+    } catch (itk::ExceptionObject &err) {
+      std::cerr << "ExceptionObject caught!" << std::endl;
+      std::cerr << err << std::endl;
+      status = -1;
+    }
   }
 
-  return 0;
+  return status;
 }
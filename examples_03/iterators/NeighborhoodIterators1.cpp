@@ -1,4 +1,3 @@
-#include "itkRescaleIntensityImageFilter.h"
 #include "itkUnaryFunctorImageFilter.h"
 #include "otbImage.h"
 #include "otbImageFileReader.h"
@@ -7,7 +6,12 @@
 #include "itkConstNeighborhoodIterator.h"
 #include "itkImageRegionIterator.h"
 
+#include "PipelineProfiler.h"
+#include "StreamingRescaleIntensityImageFilter.h"
+
 int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
   if (argc < 3) {
     std::cerr << "Missing parameters. " << std::endl;
     std::cerr << "Usage: " << std::endl;
@@ -36,6 +40,7 @@ int main(int argc, char *argv[]) {
   ReaderType::Pointer reader = ReaderType::New();
   reader->SetFileName(argv[1]);
   try {
+    profiler.Attach(reader);
     reader->Update();
   } catch (itk::ExceptionObject &err) {
     std::cout << "ExceptionObject caught!" << std::endl;
@@ -73,18 +78,22 @@ int main(int argc, char *argv[]) {
   using WriterType = otb::ImageFileWriter<WriteImageType>;
 
   using RescaleFilterType =
-      itk::RescaleIntensityImageFilter<ImageType, WriteImageType>;
+      otb::StreamingRescaleIntensityImageFilter<ImageType, WriteImageType>;
 
   RescaleFilterType::Pointer rescaler = RescaleFilterType::New();
 
   rescaler->SetOutputMinimum(0);
   rescaler->SetOutputMaximum(255);
+  rescaler->SetStatisticsFileName(std::string(argv[1]) + ".rescale-stats");
+  rescaler->SetStatisticsKey(
+      otb::RescaleStatisticsKey(argv[1], "NeighborhoodIterators1:SobelX"));
   rescaler->SetInput(output);
 
   WriterType::Pointer writer = WriterType::New();
   writer->SetFileName(argv[2]);
   writer->SetInput(rescaler->GetOutput());
   try {
+    profiler.Attach(writer);
     writer->Update();
   } catch (itk::ExceptionObject &err) {
     std::cout << "ExceptionObject caught !" << std::endl;
@@ -1,15 +1,18 @@
-#include "itkConstNeighborhoodIterator.h"
-#include "itkImageRegionIterator.h"
-#include "itkRescaleIntensityImageFilter.h"
 #include "itkUnaryFunctorImageFilter.h"
 #include "otbImage.h"
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
 
-#include "itkNeighborhoodInnerProduct.h"
 #include "itkSobelOperator.h"
 
+#include "SeparableNeighborhoodOperatorImageFilter.h"
+
+#include "PipelineProfiler.h"
+#include "StreamingRescaleIntensityImageFilter.h"
+
 int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
   if (argc < 4) {
     std::cerr << "Missing parameters. " << std::endl;
     std::cerr << "Usage: " << std::endl;
@@ -22,56 +25,53 @@ int main(int argc, char *argv[]) {
   using ImageType = otb::Image<PixelType, 2>;
   using ReaderType = otb::ImageFileReader<ImageType>;
 
-  using NeighborhoodIteratorType = itk::ConstNeighborhoodIterator<ImageType>;
-  using IteratorType = itk::ImageRegionIterator<ImageType>;
-
   ReaderType::Pointer reader = ReaderType::New();
   reader->SetFileName(argv[1]);
+  // Only the image information is read here; the pixels are read tile by
+  // tile when the writer streams the pipeline
   try {
-    reader->Update();
+    reader->UpdateOutputInformation();
   } catch (itk::ExceptionObject &err) {
     std::cout << "ExceptionObject caught !" << std::endl;
     std::cout << err << std::endl;
     return -1;
   }
 
-  ImageType::Pointer output = ImageType::New();
-  output->SetRegions(reader->GetOutput()->GetRequestedRegion());
-  output->Allocate();
-
-  IteratorType out(output, reader->GetOutput()->GetRequestedRegion());
-
   itk::SobelOperator<PixelType, 2> sobelOperator;
   sobelOperator.SetDirection(::atoi(argv[3]));
   sobelOperator.CreateDirectional();
 
-  NeighborhoodIteratorType::RadiusType radius = sobelOperator.GetRadius();
-  NeighborhoodIteratorType it(radius, reader->GetOutput(),
-                              reader->GetOutput()->GetRequestedRegion());
-
-  itk::NeighborhoodInnerProduct<ImageType> innerProduct;
-
-  for (it.GoToBegin(), out.GoToBegin(); !it.IsAtEnd(); ++it, ++out) {
-    out.Set(innerProduct(it, sobelOperator));
-  }
+  // The Sobel operator is separable, so the filter applies it as two 1D
+  // passes instead of a dense 3x3 inner product at every pixel
+  using OperatorFilterType =
+      otb::SeparableNeighborhoodOperatorImageFilter<ImageType, PixelType>;
+  OperatorFilterType::Pointer operatorFilter = OperatorFilterType::New();
+  operatorFilter->SetOperator(sobelOperator);
+  operatorFilter->SetInput(reader->GetOutput());
 
   using WritePixelType = unsigned char;
   using WriteImageType = otb::Image<WritePixelType, 2>;
   using WriterType = otb::ImageFileWriter<WriteImageType>;
 
+  // The Sobel output is rescaled in two streamed passes, the first of which
+  // is skipped when the sidecar already holds its extrema
   using RescaleFilterType =
-      itk::RescaleIntensityImageFilter<ImageType, WriteImageType>;
+      otb::StreamingRescaleIntensityImageFilter<ImageType, WriteImageType>;
 
   RescaleFilterType::Pointer rescaler = RescaleFilterType::New();
 
   rescaler->SetOutputMinimum(0);
   rescaler->SetOutputMaximum(255);
-  rescaler->SetInput(output);
+  rescaler->SetStatisticsFileName(std::string(argv[1]) + ".rescale-stats");
+  rescaler->SetStatisticsKey(otb::RescaleStatisticsKey(
+      argv[1], std::string("NeighborhoodIterators2:Sobel:") + argv[3]));
+  rescaler->SetInput(operatorFilter->GetOutput());
 
   WriterType::Pointer writer = WriterType::New();
   writer->SetFileName(argv[2]);
   writer->SetInput(rescaler->GetOutput());
   try {
+    profiler.Attach(writer);
     writer->Update();
   } catch (itk::ExceptionObject &err) {
     std::cout << "ExceptionObject caught !" << std::endl;
@@ -0,0 +1,157 @@
+//  Extracts a region of interest of an image, as the iterator loop of the
+//  ImageRegionIterator example does, but as a pipeline filter.
+//
+//  Copying the window out of \code{reader->GetOutput()} requires the whole
+//  image to be read first.  This filter instead declares the window as the
+//  region it needs from its input, so the reader only decodes the tiles or
+//  strips that intersect it, and the filter streams like any other: each
+//  requested piece of the output maps to the same piece of the window.
+//
+//  The output largest possible region starts at index 0 and has the size of
+//  the window; its origin is the physical position of the window's first
+//  pixel, so the extracted image stays registered with the input.
+
+#ifndef RegionExtractionImageFilter_h
+#define RegionExtractionImageFilter_h
+
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageToImageFilter.h"
+
+namespace otb {
+
+template <class TImageType>
+class ITK_EXPORT RegionExtractionImageFilter
+    : public itk::ImageToImageFilter<TImageType, TImageType> {
+public:
+  using Self = RegionExtractionImageFilter<TImageType>;
+  using Superclass = itk::ImageToImageFilter<TImageType, TImageType>;
+  using Pointer = itk::SmartPointer<Self>;
+  using ConstPointer = itk::SmartPointer<const Self>;
+
+  /** Method for creation through object factory */
+  itkNewMacro(Self);
+
+  /** Run-time type information */
+  itkTypeMacro(RegionExtractionImageFilter, itk::ImageToImageFilter);
+
+  /** Display */
+  void PrintSelf(std::ostream &os, itk::Indent indent) const override;
+
+  using RegionType = typename TImageType::RegionType;
+  using IndexType = typename TImageType::IndexType;
+  using PointType = typename TImageType::PointType;
+
+  /** Window to extract, in the index space of the input */
+  itkGetConstReferenceMacro(RegionOfInterest, RegionType);
+  itkSetMacro(RegionOfInterest, RegionType);
+
+protected:
+  RegionExtractionImageFilter() = default;
+  ~RegionExtractionImageFilter() override = default;
+
+  void GenerateOutputInformation() override;
+  void GenerateInputRequestedRegion() override;
+  void DynamicThreadedGenerateData(const RegionType &outputRegion) override;
+
+  /** Input region holding the pixels of the given output region */
+  RegionType ToInputRegion(const RegionType &outputRegion) const;
+
+private:
+  RegionExtractionImageFilter(const Self &) = delete;
+  void operator=(const Self &) = delete;
+
+  RegionType m_RegionOfInterest;
+};
+
+} /* namespace otb */
+
+namespace otb {
+
+//  The window must lie inside the input, which is known once the input
+//  information is, i.e. before anything is read.
+
+template <class TImageType>
+void RegionExtractionImageFilter<TImageType>::GenerateOutputInformation() {
+  Superclass::GenerateOutputInformation();
+
+  const TImageType *inputImage = this->GetInput();
+  TImageType *outputImage = this->GetOutput();
+  if (!inputImage) {
+    return;
+  }
+
+  if (!inputImage->GetLargestPossibleRegion().IsInside(m_RegionOfInterest)) {
+    itkExceptionMacro(<< "The region " << m_RegionOfInterest
+                      << " is not contained within the input image region "
+                      << inputImage->GetLargestPossibleRegion());
+  }
+
+  RegionType outputRegion;
+  outputRegion.SetSize(m_RegionOfInterest.GetSize());
+
+  PointType outputOrigin;
+  inputImage->TransformIndexToPhysicalPoint(m_RegionOfInterest.GetIndex(),
+                                            outputOrigin);
+
+  outputImage->SetLargestPossibleRegion(outputRegion);
+  outputImage->SetOrigin(outputOrigin);
+}
+
+template <class TImageType>
+typename RegionExtractionImageFilter<TImageType>::RegionType
+RegionExtractionImageFilter<TImageType>::ToInputRegion(
+    const RegionType &outputRegion) const {
+  RegionType inputRegion = outputRegion;
+  IndexType inputIndex = outputRegion.GetIndex();
+  for (unsigned int i = 0; i < TImageType::ImageDimension; ++i) {
+    inputIndex[i] += m_RegionOfInterest.GetIndex()[i];
+  }
+  inputRegion.SetIndex(inputIndex);
+  return inputRegion;
+}
+
+//  Only the part of the window matching the output requested region is
+//  requested from the input, which is what limits the reading to it.
+
+template <class TImageType>
+void RegionExtractionImageFilter<TImageType>::GenerateInputRequestedRegion() {
+  Superclass::GenerateInputRequestedRegion();
+
+  TImageType *inputImage = const_cast<TImageType *>(this->GetInput());
+  if (!inputImage) {
+    return;
+  }
+
+  inputImage->SetRequestedRegion(
+      this->ToInputRegion(this->GetOutput()->GetRequestedRegion()));
+}
+
+template <class TImageType>
+void RegionExtractionImageFilter<TImageType>::DynamicThreadedGenerateData(
+    const RegionType &outputRegion) {
+  using ConstIteratorType = itk::ImageRegionConstIterator<TImageType>;
+  using IteratorType = itk::ImageRegionIterator<TImageType>;
+
+  ConstIteratorType inputIt(this->GetInput(),
+                            this->ToInputRegion(outputRegion));
+  IteratorType outputIt(this->GetOutput(), outputRegion);
+
+  for (inputIt.GoToBegin(), outputIt.GoToBegin(); !inputIt.IsAtEnd();
+       ++inputIt, ++outputIt) {
+    outputIt.Set(inputIt.Get());
+  }
+}
+
+template <class TImageType>
+void RegionExtractionImageFilter<TImageType>::PrintSelf(
+    std::ostream &os, itk::Indent indent) const {
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "RegionOfInterest: " << this->m_RegionOfInterest
+     << std::endl;
+}
+
+} /* end namespace otb */
+
+#endif
@@ -0,0 +1,344 @@
+//  Reads windows of rasters through a shared cache of decoded tiles.
+//
+//  Each source raster is opened once and kept open, so its header is parsed
+//  once however many windows are read from it.  The raster is divided into
+//  tiles of about \code{TileSize} pixels, aligned on the blocks of the file
+//  (its tiles, or its strips), and a window is assembled from the decoded
+//  tiles it overlaps.  Decoded tiles are kept in a least recently used
+//  cache, bounded by a memory budget, so windows that overlap or that are
+//  close to each other decode their common tiles only once.
+//
+//  The cache is shared by all the threads reading from it.  A tile being
+//  decoded by one thread is waited for, not decoded again, by the others.
+//  Since a GDAL dataset handle must not be used by two threads at once, each
+//  source keeps a pool of handles and opens a new one only when all of its
+//  handles are busy.  Tiles hold all the bands of their pixels, interleaved
+//  as in a \doxygen{otb}{VectorImage}.
+
+#ifndef TiledRasterCache_h
+#define TiledRasterCache_h
+
+#include "itkMacro.h"
+
+#include "gdal.h"
+
+#include "MappedRasterImage.h"
+
+#include <algorithm>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace otb {
+
+template <class TValue> class TiledRasterCache {
+public:
+  using ValueType = TValue;
+
+  /** Size and georeferencing of a source raster */
+  struct RasterInfo {
+    long Width;
+    long Height;
+    int NbBands;
+    double GeoTransform[6];
+    std::string ProjectionRef;
+  };
+
+  /** memoryBudget is in bytes, tileSize in pixels */
+  explicit TiledRasterCache(size_t memoryBudget, long tileSize = 256)
+      : m_MemoryBudget(memoryBudget), m_TileSize(std::max<long>(tileSize, 1)) {
+    GDALAllRegister();
+  }
+
+  ~TiledRasterCache() {
+    for (auto &source : m_Sources) {
+      for (GDALDatasetH dataset : source.second->Idle) {
+        GDALClose(dataset);
+      }
+    }
+  }
+
+  TiledRasterCache(const TiledRasterCache &) = delete;
+  void operator=(const TiledRasterCache &) = delete;
+
+  /** Information on a source, opening it if it is not yet */
+  RasterInfo GetRasterInfo(const std::string &fileName) {
+    return this->GetSource(fileName)->Info;
+  }
+
+  /** Read a window of a source into buffer, which receives sizeX * sizeY
+   * pixels of NbBands interleaved values, row after row */
+  void Read(const std::string &fileName, long startX, long startY, long sizeX,
+            long sizeY, ValueType *buffer);
+
+  /** Cache statistics */
+  unsigned long long GetHits() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Hits;
+  }
+  unsigned long long GetMisses() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Misses;
+  }
+  size_t GetMemoryUsage() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_MemoryUsage;
+  }
+
+private:
+  struct Source {
+    std::string FileName;
+    RasterInfo Info;
+    long TileWidth;
+    long TileHeight;
+    std::mutex Mutex;
+    std::vector<GDALDatasetH> Idle;
+  };
+
+  struct Tile {
+    long Width;
+    long Height;
+    std::vector<ValueType> Data;
+  };
+
+  using TilePointer = std::shared_ptr<const Tile>;
+  using Key = std::tuple<const Source *, long, long>;
+
+  struct Entry {
+    std::shared_future<TilePointer> Tile;
+    typename std::list<Key>::iterator Position;
+    size_t Bytes;
+    bool Ready;
+  };
+
+  Source *GetSource(const std::string &fileName);
+  TilePointer GetTile(Source *source, long tileX, long tileY);
+  TilePointer Decode(Source *source, long tileX, long tileY);
+
+  /** Drop the least recently used decoded tiles until the budget is met.
+   * Called with m_Mutex held. */
+  void Evict();
+
+  size_t m_MemoryBudget;
+  long m_TileSize;
+
+  mutable std::mutex m_Mutex;
+  std::map<std::string, std::unique_ptr<Source>> m_Sources;
+  std::map<Key, Entry> m_Entries;
+  std::list<Key> m_RecentlyUsed;
+  size_t m_MemoryUsage = 0;
+  unsigned long long m_Hits = 0;
+  unsigned long long m_Misses = 0;
+};
+
+//  The first handle of a source is opened with the cache locked, so that
+//  two threads asking for a new source do not both parse its header.
+
+template <class TValue>
+typename TiledRasterCache<TValue>::Source *
+TiledRasterCache<TValue>::GetSource(const std::string &fileName) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  auto found = m_Sources.find(fileName);
+  if (found != m_Sources.end()) {
+    return found->second.get();
+  }
+
+  GDALDatasetH dataset = GDALOpen(fileName.c_str(), GA_ReadOnly);
+  if (!dataset || GDALGetRasterCount(dataset) == 0) {
+    if (dataset) {
+      GDALClose(dataset);
+    }
+    itkGenericExceptionMacro(<< "Cannot open the raster " << fileName);
+  }
+
+  std::unique_ptr<Source> source(new Source);
+  source->FileName = fileName;
+  source->Info.Width = GDALGetRasterXSize(dataset);
+  source->Info.Height = GDALGetRasterYSize(dataset);
+  source->Info.NbBands = GDALGetRasterCount(dataset);
+  GDALGetGeoTransform(dataset, source->Info.GeoTransform);
+  const char *projection = GDALGetProjectionRef(dataset);
+  source->Info.ProjectionRef = projection ? projection : "";
+
+  // Whole blocks per tile, so that no block is decoded for two tiles
+  int blockWidth = 1;
+  int blockHeight = 1;
+  GDALGetBlockSize(GDALGetRasterBand(dataset, 1), &blockWidth, &blockHeight);
+  blockWidth = std::max(blockWidth, 1);
+  blockHeight = std::max(blockHeight, 1);
+  source->TileWidth =
+      std::min((m_TileSize + blockWidth - 1) / blockWidth * blockWidth,
+               source->Info.Width);
+  source->TileHeight =
+      std::min((m_TileSize + blockHeight - 1) / blockHeight * blockHeight,
+               source->Info.Height);
+  source->Idle.push_back(dataset);
+
+  Source *result = source.get();
+  m_Sources[fileName] = std::move(source);
+  return result;
+}
+
+template <class TValue>
+typename TiledRasterCache<TValue>::TilePointer
+TiledRasterCache<TValue>::Decode(Source *source, long tileX, long tileY) {
+  GDALDatasetH dataset = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(source->Mutex);
+    if (!source->Idle.empty()) {
+      dataset = source->Idle.back();
+      source->Idle.pop_back();
+    }
+  }
+  if (!dataset) {
+    dataset = GDALOpen(source->FileName.c_str(), GA_ReadOnly);
+    if (!dataset) {
+      itkGenericExceptionMacro(<< "Cannot reopen the raster "
+                               << source->FileName);
+    }
+  }
+
+  const int nbBands = source->Info.NbBands;
+  const long x0 = tileX * source->TileWidth;
+  const long y0 = tileY * source->TileHeight;
+
+  std::shared_ptr<Tile> tile(new Tile);
+  tile->Width = std::min(source->TileWidth, source->Info.Width - x0);
+  tile->Height = std::min(source->TileHeight, source->Info.Height - y0);
+  tile->Data.resize(tile->Width * tile->Height * nbBands);
+
+  const int valueSize = sizeof(ValueType);
+  const CPLErr error = GDALDatasetRasterIO(
+      dataset, GF_Read, x0, y0, tile->Width, tile->Height, tile->Data.data(),
+      tile->Width, tile->Height, GetGDALDataType<ValueType>(), nbBands,
+      nullptr, nbBands * valueSize, tile->Width * nbBands * valueSize,
+      valueSize);
+
+  {
+    std::lock_guard<std::mutex> lock(source->Mutex);
+    source->Idle.push_back(dataset);
+  }
+  if (error != CE_None) {
+    itkGenericExceptionMacro(<< "Cannot decode the tile (" << tileX << ", "
+                             << tileY << "): " << CPLGetLastErrorMsg());
+  }
+  return tile;
+}
+
+//  The entry of a tile is created, not ready, by the first thread that
+//  misses it; that thread decodes the tile without holding the cache lock,
+//  and the threads asking for the same tile meanwhile wait on its future.
+
+template <class TValue>
+typename TiledRasterCache<TValue>::TilePointer
+TiledRasterCache<TValue>::GetTile(Source *source, long tileX, long tileY) {
+  const Key key(source, tileX, tileY);
+
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  auto found = m_Entries.find(key);
+  if (found != m_Entries.end()) {
+    ++m_Hits;
+    m_RecentlyUsed.splice(m_RecentlyUsed.begin(), m_RecentlyUsed,
+                          found->second.Position);
+    std::shared_future<TilePointer> tile = found->second.Tile;
+    lock.unlock();
+    return tile.get();
+  }
+
+  ++m_Misses;
+  std::promise<TilePointer> promise;
+  m_RecentlyUsed.push_front(key);
+  m_Entries[key] = {promise.get_future().share(), m_RecentlyUsed.begin(), 0,
+                    false};
+  lock.unlock();
+
+  TilePointer tile;
+  try {
+    tile = this->Decode(source, tileX, tileY);
+  } catch (...) {
+    lock.lock();
+    auto entry = m_Entries.find(key);
+    m_RecentlyUsed.erase(entry->second.Position);
+    m_Entries.erase(entry);
+    promise.set_exception(std::current_exception());
+    throw;
+  }
+  promise.set_value(tile);
+
+  lock.lock();
+  Entry &entry = m_Entries[key];
+  entry.Bytes = tile->Data.size() * sizeof(ValueType);
+  entry.Ready = true;
+  m_MemoryUsage += entry.Bytes;
+  this->Evict();
+  return tile;
+}
+
+//  Tiles still being decoded are never evicted.  An evicted tile stays
+//  alive as long as a reader holds it.
+
+template <class TValue> void TiledRasterCache<TValue>::Evict() {
+  auto position = m_RecentlyUsed.end();
+  while (m_MemoryUsage > m_MemoryBudget &&
+         position != m_RecentlyUsed.begin()) {
+    --position;
+    auto entry = m_Entries.find(*position);
+    if (!entry->second.Ready) {
+      continue;
+    }
+    m_MemoryUsage -= entry->second.Bytes;
+    position = m_RecentlyUsed.erase(position);
+    m_Entries.erase(entry);
+  }
+}
+
+template <class TValue>
+void TiledRasterCache<TValue>::Read(const std::string &fileName, long startX,
+                                    long startY, long sizeX, long sizeY,
+                                    ValueType *buffer) {
+  Source *source = this->GetSource(fileName);
+  const RasterInfo &info = source->Info;
+  if (startX < 0 || startY < 0 || sizeX <= 0 || sizeY <= 0 ||
+      startX + sizeX > info.Width || startY + sizeY > info.Height) {
+    itkGenericExceptionMacro(<< "The window (" << startX << ", " << startY
+                             << ", " << sizeX << ", " << sizeY
+                             << ") is not contained within the "
+                             << info.Width << " x " << info.Height
+                             << " raster " << fileName);
+  }
+
+  const long nbBands = info.NbBands;
+  for (long tileY = startY / source->TileHeight;
+       tileY * source->TileHeight < startY + sizeY; ++tileY) {
+    for (long tileX = startX / source->TileWidth;
+         tileX * source->TileWidth < startX + sizeX; ++tileX) {
+      const TilePointer tile = this->GetTile(source, tileX, tileY);
+
+      // Intersection of the window and the tile, in raster coordinates
+      const long tileX0 = tileX * source->TileWidth;
+      const long tileY0 = tileY * source->TileHeight;
+      const long x0 = std::max(startX, tileX0);
+      const long x1 = std::min(startX + sizeX, tileX0 + tile->Width);
+      const long y0 = std::max(startY, tileY0);
+      const long y1 = std::min(startY + sizeY, tileY0 + tile->Height);
+
+      for (long y = y0; y < y1; ++y) {
+        const ValueType *from =
+            tile->Data.data() +
+            ((y - tileY0) * tile->Width + (x0 - tileX0)) * nbBands;
+        ValueType *to =
+            buffer + ((y - startY) * sizeX + (x0 - startX)) * nbBands;
+        std::copy(from, from + (x1 - x0) * nbBands, to);
+      }
+    }
+  }
+}
+
+} // namespace otb
+
+#endif
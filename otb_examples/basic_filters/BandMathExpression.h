@@ -0,0 +1,711 @@
+//  Band math expressions compiled once and evaluated on blocks of pixels.
+//
+//  \doxygen{otb}{Parser} interprets the muParser bytecode of the expression
+//  for every single pixel.  This class parses the expression once into a
+//  flat program of instructions working on registers of \code{BlockSize}
+//  values, so each instruction is a simple loop over a block of pixels that
+//  the compiler can vectorize, and the cost of the interpretation is paid
+//  once per block instead of once per pixel.  Sub-expressions involving
+//  only constants are folded when the expression is compiled.
+//
+//  Several expressions can be compiled into the same program.  Identical
+//  sub-expressions (such as \code{b4+b3}, written in either order, in NDVI
+//  and SAVI) are then computed only once per block, and the results of all
+//  the expressions are written interleaved, one band per expression.
+//
+//  The syntax follows the subset of muParser used for band math:
+//
+//  \begin{itemize}
+//  \item the variables \code{b1} .. \code{bN} and the constants \code{_pi}
+//        and \code{_e};
+//  \item the operators \code{+ - * / ^}, the comparisons
+//        \code{< <= > >= == !=}, the logical operators \code{\&\& ||} and
+//        \code{!}, and the ternary operator \code{c ? a : b};
+//  \item \code{if(c, a, b)}, \code{min}, \code{max}, \code{sum}, \code{avg}
+//        (any number of arguments), \code{ndvi(r, nir)} and the usual
+//        one-argument functions (\code{abs}, \code{sqrt}, \code{exp},
+//        \code{log}, \code{ln}, \code{log2}, \code{log10}, the trigonometric
+//        and hyperbolic functions, \code{sign}, \code{rint}).
+//  \end{itemize}
+//
+//  Comparisons and logical operators give 1 or 0, and a condition is true
+//  when it is not 0, as in muParser.  Both branches of a conditional are
+//  evaluated for the whole block and the result is selected per pixel.
+//
+//  The program is compiled, and its constants folded, in \code{double}, but
+//  it can be evaluated in \code{float} registers: a block then fits twice as
+//  many values per vector instruction, for a relative error of the order of
+//  the \code{float} epsilon on each operation.
+
+#ifndef BandMathExpression_h
+#define BandMathExpression_h
+
+#include "itkMacro.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace otb {
+
+class BandMathExpression {
+public:
+  /** Number of pixels evaluated at once */
+  static constexpr unsigned int BlockSize = 256;
+
+  /** Registers of one evaluation in TReal (float or double); each thread
+   * needs its own workspace */
+  template <class TReal = double> using Workspace = std::vector<TReal>;
+
+  /** Parse the expressions for an image with the given number of bands.
+   * Throws an itk::ExceptionObject on a syntax error, an unknown variable or
+   * an unknown function. */
+  void Compile(const std::vector<std::string> &expressions,
+               unsigned int nbBands) {
+    m_NumberOfBands = nbBands;
+    m_Instructions.clear();
+    m_Bands.clear();
+    m_Results.clear();
+    m_Registers.clear();
+    m_NumberOfRegisters = 0;
+
+    for (const std::string &expression : expressions) {
+      m_Expression = expression;
+      m_Position = 0;
+
+      Operand result = this->ParseTernary();
+      this->SkipSpaces();
+      if (m_Position != m_Expression.size()) {
+        this->Fail("unexpected character");
+      }
+      m_Results.push_back(this->Materialize(result));
+    }
+  }
+
+  void Compile(const std::string &expression, unsigned int nbBands) {
+    this->Compile(std::vector<std::string>(1, expression), nbBands);
+  }
+
+  /** Allocate the registers needed to evaluate the compiled program */
+  template <class TReal>
+  void InitializeWorkspace(Workspace<TReal> &workspace) const {
+    workspace.assign(static_cast<size_t>(m_NumberOfRegisters) * BlockSize,
+                     TReal(0));
+  }
+
+  /** Evaluate the expressions on count <= BlockSize pixels whose bands are
+   * interleaved, as in the buffer of an otb::VectorImage.  The results are
+   * interleaved the same way, one value per expression and pixel. */
+  template <class TValue, class TReal>
+  void Evaluate(const TValue *pixels, unsigned int count, TReal *result,
+                Workspace<TReal> &workspace) const {
+    TReal *registers = workspace.data();
+
+    // Gather the bands used by the expression into their registers
+    for (const BandLoad &load : m_Bands) {
+      TReal *band = registers + load.Register * BlockSize;
+      const TValue *value = pixels + load.Band;
+      for (unsigned int i = 0; i < count; ++i, value += m_NumberOfBands) {
+        band[i] = static_cast<TReal>(*value);
+      }
+    }
+
+    for (const Instruction &instruction : m_Instructions) {
+      this->Execute(instruction, registers, count);
+    }
+
+    const size_t nbOutputs = m_Results.size();
+    for (size_t k = 0; k < nbOutputs; ++k) {
+      const TReal *output = registers + m_Results[k] * BlockSize;
+      for (unsigned int i = 0; i < count; ++i) {
+        result[i * nbOutputs + k] = output[i];
+      }
+    }
+  }
+
+  unsigned int GetNumberOfBands() const { return m_NumberOfBands; }
+
+  unsigned int GetNumberOfOutputs() const {
+    return static_cast<unsigned int>(m_Results.size());
+  }
+
+private:
+  enum OpCode {
+    Constant,
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Power,
+    Negate,
+    Not,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    Equal,
+    NotEqual,
+    And,
+    Or,
+    Minimum,
+    Maximum,
+    Select,
+    Function
+  };
+
+  typedef double (*FunctionType)(double);
+
+  struct Instruction {
+    OpCode Op;
+    int Destination;
+    int A;
+    int B;
+    int C;
+    double Value;
+    FunctionType Callee;
+  };
+
+  struct BandLoad {
+    unsigned int Band;
+    int Register;
+  };
+
+  //  While parsing, an operand is either a register holding a value per
+  //  pixel, or a constant which is not loaded into a register until an
+  //  instruction needs it.
+
+  struct Operand {
+    bool IsConstant;
+    double Value;
+    int Register;
+  };
+
+  static Operand MakeConstant(double value) { return {true, value, -1}; }
+  static Operand MakeRegister(int reg) { return {false, 0.0, reg}; }
+
+  static double Apply(OpCode op, double a, double b, double c) {
+    switch (op) {
+    case Add:
+      return a + b;
+    case Subtract:
+      return a - b;
+    case Multiply:
+      return a * b;
+    case Divide:
+      return a / b;
+    case Power:
+      return std::pow(a, b);
+    case Negate:
+      return -a;
+    case Not:
+      return a == 0.0;
+    case Less:
+      return a < b;
+    case LessEqual:
+      return a <= b;
+    case Greater:
+      return a > b;
+    case GreaterEqual:
+      return a >= b;
+    case Equal:
+      return a == b;
+    case NotEqual:
+      return a != b;
+    case And:
+      return (a != 0.0) && (b != 0.0);
+    case Or:
+      return (a != 0.0) || (b != 0.0);
+    case Minimum:
+      return std::min(a, b);
+    case Maximum:
+      return std::max(a, b);
+    case Select:
+      return (a != 0.0) ? b : c;
+    default:
+      return 0.0;
+    }
+  }
+
+  template <class TReal>
+  void Execute(const Instruction &instruction, TReal *registers,
+               unsigned int count) const {
+    TReal *d = registers + instruction.Destination * BlockSize;
+    const TReal *a = registers + instruction.A * BlockSize;
+    const TReal *b = registers + instruction.B * BlockSize;
+    const TReal *c = registers + instruction.C * BlockSize;
+    const TReal zero(0);
+    const TReal one(1);
+
+    // One loop per operation, so each of them can be vectorized
+    switch (instruction.Op) {
+    case Constant:
+      std::fill(d, d + count, static_cast<TReal>(instruction.Value));
+      break;
+    case Add:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = a[i] + b[i];
+      break;
+    case Subtract:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = a[i] - b[i];
+      break;
+    case Multiply:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = a[i] * b[i];
+      break;
+    case Divide:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = a[i] / b[i];
+      break;
+    case Power:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = std::pow(a[i], b[i]);
+      break;
+    case Negate:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = -a[i];
+      break;
+    case Not:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = (a[i] == zero) ? one : zero;
+      break;
+    case Less:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = (a[i] < b[i]) ? one : zero;
+      break;
+    case LessEqual:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = (a[i] <= b[i]) ? one : zero;
+      break;
+    case Greater:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = (a[i] > b[i]) ? one : zero;
+      break;
+    case GreaterEqual:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = (a[i] >= b[i]) ? one : zero;
+      break;
+    case Equal:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = (a[i] == b[i]) ? one : zero;
+      break;
+    case NotEqual:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = (a[i] != b[i]) ? one : zero;
+      break;
+    case And:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = (a[i] != zero && b[i] != zero) ? one : zero;
+      break;
+    case Or:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = (a[i] != zero || b[i] != zero) ? one : zero;
+      break;
+    case Minimum:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = std::min(a[i], b[i]);
+      break;
+    case Maximum:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = std::max(a[i], b[i]);
+      break;
+    case Select:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = (a[i] != zero) ? b[i] : c[i];
+      break;
+    case Function:
+      for (unsigned int i = 0; i < count; ++i)
+        d[i] = static_cast<TReal>(instruction.Callee(a[i]));
+      break;
+    }
+  }
+
+  int NewRegister() { return m_NumberOfRegisters++; }
+
+  static bool IsCommutative(OpCode op) {
+    return op == Add || op == Multiply || op == Equal || op == NotEqual ||
+           op == And || op == Or || op == Minimum || op == Maximum;
+  }
+
+  //  Instructions are hash-consed: an instruction identical to one already
+  //  emitted (same operation on the same registers) reuses its register.
+  //  Since registers are never overwritten, equal registers hold equal values.
+  //  Constants are compared by their bits: a NaN, which is not equal to
+  //  itself, would break the ordering of the map.
+
+  int Intern(const Instruction &instruction) {
+    uint64_t valueBits;
+    static_assert(sizeof(valueBits) == sizeof(instruction.Value),
+                  "constants are stored as 64 bit doubles");
+    std::memcpy(&valueBits, &instruction.Value, sizeof(valueBits));
+    const InstructionKey key(instruction.Op, instruction.A, instruction.B,
+                             instruction.C, valueBits,
+                             reinterpret_cast<uintptr_t>(instruction.Callee));
+    auto found = m_Registers.find(key);
+    if (found != m_Registers.end()) {
+      return found->second;
+    }
+    Instruction emitted = instruction;
+    emitted.Destination = this->NewRegister();
+    m_Instructions.push_back(emitted);
+    m_Registers.emplace(key, emitted.Destination);
+    return emitted.Destination;
+  }
+
+  int Materialize(const Operand &operand) {
+    if (!operand.IsConstant) {
+      return operand.Register;
+    }
+    return this->Intern({Constant, -1, -1, -1, -1, operand.Value, nullptr});
+  }
+
+  Operand Emit(OpCode op, const Operand &a, const Operand &b,
+               const Operand &c) {
+    if (a.IsConstant && b.IsConstant && c.IsConstant) {
+      return MakeConstant(Apply(op, a.Value, b.Value, c.Value));
+    }
+    int ra = this->Materialize(a);
+    int rb = this->Materialize(b);
+    const int rc = this->Materialize(c);
+    if (IsCommutative(op) && rb < ra) {
+      std::swap(ra, rb);
+      // Unused third operand, kept equal to the second one
+      return MakeRegister(this->Intern({op, -1, ra, rb, rb, 0.0, nullptr}));
+    }
+    return MakeRegister(this->Intern({op, -1, ra, rb, rc, 0.0, nullptr}));
+  }
+
+  Operand Emit(OpCode op, const Operand &a, const Operand &b) {
+    return this->Emit(op, a, b, b);
+  }
+
+  Operand Emit(OpCode op, const Operand &a) { return this->Emit(op, a, a, a); }
+
+  Operand EmitFunction(FunctionType callee, const Operand &a) {
+    if (a.IsConstant) {
+      return MakeConstant(callee(a.Value));
+    }
+    return MakeRegister(this->Intern(
+        {Function, -1, a.Register, a.Register, a.Register, 0.0, callee}));
+  }
+
+  Operand LoadBand(unsigned int band) {
+    for (const BandLoad &load : m_Bands) {
+      if (load.Band == band) {
+        return MakeRegister(load.Register);
+      }
+    }
+    const int reg = this->NewRegister();
+    m_Bands.push_back({band, reg});
+    return MakeRegister(reg);
+  }
+
+  //  Recursive descent parser, from the lowest precedence (ternary operator)
+  //  to the highest (unary operators and primary expressions).
+
+  [[noreturn]] void Fail(const std::string &message) const {
+    itkGenericExceptionMacro(<< "Error in expression \"" << m_Expression
+                             << "\" at position " << m_Position << ": "
+                             << message);
+  }
+
+  void SkipSpaces() {
+    while (m_Position < m_Expression.size() &&
+           std::isspace(static_cast<unsigned char>(m_Expression[m_Position]))) {
+      ++m_Position;
+    }
+  }
+
+  bool Accept(const char *token) {
+    this->SkipSpaces();
+    const size_t length = std::char_traits<char>::length(token);
+    if (m_Expression.compare(m_Position, length, token) == 0) {
+      m_Position += length;
+      return true;
+    }
+    return false;
+  }
+
+  void Expect(const char *token) {
+    if (!this->Accept(token)) {
+      this->Fail(std::string("expected '") + token + "'");
+    }
+  }
+
+  Operand ParseTernary() {
+    Operand condition = this->ParseOr();
+    if (this->Accept("?")) {
+      Operand whenTrue = this->ParseTernary();
+      this->Expect(":");
+      Operand whenFalse = this->ParseTernary();
+      return this->Emit(Select, condition, whenTrue, whenFalse);
+    }
+    return condition;
+  }
+
+  Operand ParseOr() {
+    Operand left = this->ParseAnd();
+    while (this->Accept("||")) {
+      left = this->Emit(Or, left, this->ParseAnd());
+    }
+    return left;
+  }
+
+  Operand ParseAnd() {
+    Operand left = this->ParseComparison();
+    while (this->Accept("&&")) {
+      left = this->Emit(And, left, this->ParseComparison());
+    }
+    return left;
+  }
+
+  Operand ParseComparison() {
+    Operand left = this->ParseAdditive();
+    for (;;) {
+      // Two-character operators are tried first
+      if (this->Accept("<=")) {
+        left = this->Emit(LessEqual, left, this->ParseAdditive());
+      } else if (this->Accept(">=")) {
+        left = this->Emit(GreaterEqual, left, this->ParseAdditive());
+      } else if (this->Accept("==")) {
+        left = this->Emit(Equal, left, this->ParseAdditive());
+      } else if (this->Accept("!=")) {
+        left = this->Emit(NotEqual, left, this->ParseAdditive());
+      } else if (this->Accept("<")) {
+        left = this->Emit(Less, left, this->ParseAdditive());
+      } else if (this->Accept(">")) {
+        left = this->Emit(Greater, left, this->ParseAdditive());
+      } else {
+        return left;
+      }
+    }
+  }
+
+  Operand ParseAdditive() {
+    Operand left = this->ParseMultiplicative();
+    for (;;) {
+      if (this->Accept("+")) {
+        left = this->Emit(Add, left, this->ParseMultiplicative());
+      } else if (this->Accept("-")) {
+        left = this->Emit(Subtract, left, this->ParseMultiplicative());
+      } else {
+        return left;
+      }
+    }
+  }
+
+  Operand ParseMultiplicative() {
+    Operand left = this->ParseUnary();
+    for (;;) {
+      if (this->Accept("*")) {
+        left = this->Emit(Multiply, left, this->ParseUnary());
+      } else if (this->Accept("/")) {
+        left = this->Emit(Divide, left, this->ParseUnary());
+      } else {
+        return left;
+      }
+    }
+  }
+
+  //  As in muParser, the power operator binds tighter than the unary minus
+  //  (-2^2 is -4) and is right associative.
+
+  Operand ParseUnary() {
+    if (this->Accept("-")) {
+      return this->Emit(Negate, this->ParseUnary());
+    }
+    if (this->Accept("+")) {
+      return this->ParseUnary();
+    }
+    if (this->Accept("!")) {
+      return this->Emit(Not, this->ParseUnary());
+    }
+    return this->ParsePower();
+  }
+
+  Operand ParsePower() {
+    Operand base = this->ParsePrimary();
+    if (this->Accept("^")) {
+      return this->Emit(Power, base, this->ParseUnary());
+    }
+    return base;
+  }
+
+  std::vector<Operand> ParseArguments() {
+    std::vector<Operand> arguments;
+    this->Expect("(");
+    if (this->Accept(")")) {
+      return arguments;
+    }
+    do {
+      arguments.push_back(this->ParseTernary());
+    } while (this->Accept(","));
+    this->Expect(")");
+    return arguments;
+  }
+
+  static FunctionType FindFunction(const std::string &name) {
+    struct Entry {
+      const char *Name;
+      FunctionType Callee;
+    };
+    static const Entry functions[] = {
+        {"abs", [](double x) { return std::abs(x); }},
+        {"sqrt", [](double x) { return std::sqrt(x); }},
+        {"exp", [](double x) { return std::exp(x); }},
+        {"log", [](double x) { return std::log(x); }},
+        {"ln", [](double x) { return std::log(x); }},
+        {"log2", [](double x) { return std::log2(x); }},
+        {"log10", [](double x) { return std::log10(x); }},
+        {"sin", [](double x) { return std::sin(x); }},
+        {"cos", [](double x) { return std::cos(x); }},
+        {"tan", [](double x) { return std::tan(x); }},
+        {"asin", [](double x) { return std::asin(x); }},
+        {"acos", [](double x) { return std::acos(x); }},
+        {"atan", [](double x) { return std::atan(x); }},
+        {"sinh", [](double x) { return std::sinh(x); }},
+        {"cosh", [](double x) { return std::cosh(x); }},
+        {"tanh", [](double x) { return std::tanh(x); }},
+        {"asinh", [](double x) { return std::asinh(x); }},
+        {"acosh", [](double x) { return std::acosh(x); }},
+        {"atanh", [](double x) { return std::atanh(x); }},
+        {"rint", [](double x) { return std::rint(x); }},
+        {"sign",
+         [](double x) { return (x > 0.0) ? 1.0 : (x < 0.0) ? -1.0 : 0.0; }},
+    };
+    for (const Entry &entry : functions) {
+      if (name == entry.Name) {
+        return entry.Callee;
+      }
+    }
+    return nullptr;
+  }
+
+  Operand ParseCall(const std::string &name) {
+    std::vector<Operand> arguments = this->ParseArguments();
+    const size_t n = arguments.size();
+
+    if (name == "if") {
+      if (n != 3) {
+        this->Fail("if() takes 3 arguments");
+      }
+      return this->Emit(Select, arguments[0], arguments[1], arguments[2]);
+    }
+    if (name == "ndvi") {
+      if (n != 2) {
+        this->Fail("ndvi() takes 2 arguments");
+      }
+      // (nir - r) / (nir + r)
+      return this->Emit(Divide,
+                        this->Emit(Subtract, arguments[1], arguments[0]),
+                        this->Emit(Add, arguments[1], arguments[0]));
+    }
+    if (name == "min" || name == "max" || name == "sum" || name == "avg") {
+      if (n == 0) {
+        this->Fail(name + "() needs at least one argument");
+      }
+      const OpCode op = (name == "min")   ? Minimum
+                        : (name == "max") ? Maximum
+                                          : Add;
+      Operand result = arguments[0];
+      for (size_t i = 1; i < n; ++i) {
+        result = this->Emit(op, result, arguments[i]);
+      }
+      if (name == "avg") {
+        result = this->Emit(Divide, result,
+                            MakeConstant(static_cast<double>(n)));
+      }
+      return result;
+    }
+
+    FunctionType callee = FindFunction(name);
+    if (!callee) {
+      this->Fail("unknown function " + name);
+    }
+    if (n != 1) {
+      this->Fail(name + "() takes 1 argument");
+    }
+    return this->EmitFunction(callee, arguments[0]);
+  }
+
+  Operand ParsePrimary() {
+    this->SkipSpaces();
+    if (m_Position >= m_Expression.size()) {
+      this->Fail("unexpected end of expression");
+    }
+
+    if (this->Accept("(")) {
+      Operand inner = this->ParseTernary();
+      this->Expect(")");
+      return inner;
+    }
+
+    const char first = m_Expression[m_Position];
+    if (std::isdigit(static_cast<unsigned char>(first)) || first == '.') {
+      const char *begin = m_Expression.c_str() + m_Position;
+      char *end = nullptr;
+      const double value = std::strtod(begin, &end);
+      if (end == begin) {
+        this->Fail("invalid number");
+      }
+      m_Position += end - begin;
+      return MakeConstant(value);
+    }
+
+    if (std::isalpha(static_cast<unsigned char>(first)) || first == '_') {
+      const size_t start = m_Position;
+      while (m_Position < m_Expression.size() &&
+             (std::isalnum(static_cast<unsigned char>(
+                  m_Expression[m_Position])) ||
+              m_Expression[m_Position] == '_')) {
+        ++m_Position;
+      }
+      const std::string name = m_Expression.substr(start, m_Position - start);
+
+      this->SkipSpaces();
+      if (m_Position < m_Expression.size() && m_Expression[m_Position] == '(') {
+        return this->ParseCall(name);
+      }
+      if (name == "_pi") {
+        return MakeConstant(3.14159265358979323846);
+      }
+      if (name == "_e") {
+        return MakeConstant(2.71828182845904523536);
+      }
+      if (name.size() > 1 && name[0] == 'b' &&
+          name.find_first_not_of("0123456789", 1) == std::string::npos) {
+        const unsigned long band = std::strtoul(name.c_str() + 1, nullptr, 10);
+        if (band >= 1 && band <= m_NumberOfBands) {
+          return this->LoadBand(static_cast<unsigned int>(band - 1));
+        }
+      }
+      m_Position = start;
+      this->Fail("unknown variable " + name);
+    }
+
+    this->Fail("unexpected character");
+  }
+
+  std::string m_Expression;
+  unsigned int m_NumberOfBands = 0;
+  size_t m_Position = 0;
+
+  using InstructionKey = std::tuple<int, int, int, int, uint64_t, uintptr_t>;
+
+  std::vector<Instruction> m_Instructions;
+  std::vector<BandLoad> m_Bands;
+  std::vector<int> m_Results;
+  std::map<InstructionKey, int> m_Registers;
+  int m_NumberOfRegisters = 0;
+};
+
+} /* end namespace otb */
+
+#endif
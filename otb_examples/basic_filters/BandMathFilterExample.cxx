@@ -1,5 +1,6 @@
 #include "itkMacro.h"
 #include <iostream>
+#include <type_traits>
 
 #include "itkCastImageFilter.h"
 #include "itkUnaryFunctorImageFilter.h"
@@ -7,64 +8,47 @@
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
 #include "otbVectorImage.h"
-#include "otbVectorImageToImageListFilter.h"
 
 // We start by including the required header file.
 // The aim of this example is to compute the Normalized Difference Vegetation
 // Index (NDVI) from a multispectral image and then apply a threshold to this
 // index to extract areas containing a dense vegetation canopy.
-#include "otbBandMathImageFilter.h"
+#include "VectorBandMathImageFilter.h"
 
-int main(int argc, char *argv[]) {
-  if (argc != 4) {
-    std::cerr << "Usage: " << argv[0] << " inputImageFile ";
-    std::cerr << " outputImageFile ";
-    std::cerr << " outputPrettyImageFile" << std::endl;
-    return EXIT_FAILURE;
-  }
+#include "ComputePrecision.h"
+#include "PipelineProfiler.h"
 
+// The example, for images of TReal pixels (float or double)
+template <class TReal>
+int Run(int argc, char *argv[], otb::PipelineProfiler &profiler) {
   // We start by the typedefs needed for reading and
-  // writing the images. The BandMathImageFilter class
-  // works with Image as input, so we need to define additional
-  // filters to extract each layer of the multispectral image.
-  using PixelType = double;
+  // writing the images. The VectorBandMathImageFilter class works directly
+  // with the multispectral VectorImage: the bands of each pixel are read in
+  // place from the interleaved buffer, so no layer needs to be extracted.
+  // With float pixels (--precision f32), the expressions are evaluated in
+  // float too, which may flip pixels close to the threshold.
+  using PixelType = TReal;
   using InputImageType = otb::VectorImage<PixelType, 2>;
   using OutputImageType = otb::Image<PixelType, 2>;
-  using ImageListType = otb::ImageList<OutputImageType>;
-  using VectorImageToImageListType =
-      otb::VectorImageToImageListFilter<InputImageType, ImageListType>;
   using ReaderType = otb::ImageFileReader<InputImageType>;
   using WriterType = otb::ImageFileWriter<OutputImageType>;
 
   // We can now define the type for the filter
-  using FilterType = otb::BandMathImageFilter<OutputImageType>;
+  using FilterType =
+      otb::VectorBandMathImageFilter<InputImageType, OutputImageType>;
 
   // We instantiate the filter, the reader, and the writer
-  ReaderType::Pointer reader = ReaderType::New();
-  WriterType::Pointer writer = WriterType::New();
-  FilterType::Pointer filter = FilterType::New();
+  typename ReaderType::Pointer reader = ReaderType::New();
+  typename WriterType::Pointer writer = WriterType::New();
+  typename FilterType::Pointer filter = FilterType::New();
 
   writer->SetInput(filter->GetOutput());
   reader->SetFileName(argv[1]);
   writer->SetFileName(argv[2]);
 
-  reader->UpdateOutputInformation();
-
-  // We now need to extract each band from the input VectorImage,
-  // it illustrates the use of the VectorImageToImageList.
-  // Each extracted layer is an input to the BandMathImageFilter
-  VectorImageToImageListType::Pointer imageList =
-      VectorImageToImageListType::New();
-  imageList->SetInput(reader->GetOutput());
-
-  imageList->UpdateOutputInformation();
-
-  const unsigned int nbBands =
-      reader->GetOutput()->GetNumberOfComponentsPerPixel();
-
-  for (unsigned int j = 0; j < nbBands; ++j) {
-    filter->SetNthInput(j, imageList->GetOutput()->GetNthElement(j));
-  }
+  // The bands of the input image are the variables b1, b2, ... of the
+  // expression
+  filter->SetInput(reader->GetOutput());
 
   // Now we can define the mathematical expression to perform on the layers (b1,
   // b2, b3, b4). The filter takes advantage of the parsing capabilities of the
@@ -72,16 +56,14 @@ int main(int argc, char *argv[]) {
   // calculator.
 
   // The expression below returns 255 if the ratio (NIR-RED)/(NIR+RED) is
-  // greater than 0.4 and 0 if not.
+  // greater than 0.4 and 0 if not.  The expression is compiled by the filter,
+  // which accepts both the if() function and the C++ ternary operator
+  // ("((b4-b3)/(b4+b3) > 0.4) ? 255 : 0") whatever the muParser version.
   filter->SetExpression("if((b4-b3)/(b4+b3) > 0.4, 255, 0)");
-
-#ifdef OTB_MUPARSER_HAS_CXX_LOGICAL_OPERATORS
-  filter->SetExpression("((b4-b3)/(b4+b3) > 0.4) ? 255 : 0");
-#else
-  filter->SetExpression("if((b4-b3)/(b4+b3) > 0.4, 255, 0)");
-#endif
+  filter->SetSinglePrecision(std::is_same<TReal, float>::value);
 
   // We can now run the pipeline
+  profiler.Attach(writer);
   writer->Update();
 
   // The muParser library also provides the possibility to extend existing
@@ -94,13 +76,63 @@ int main(int argc, char *argv[]) {
   using CastImageFilterType =
       itk::CastImageFilter<OutputImageType, OutputPrettyImageType>;
 
-  PrettyImageFileWriterType::Pointer prettyWriter =
+  typename PrettyImageFileWriterType::Pointer prettyWriter =
       PrettyImageFileWriterType::New();
-  CastImageFilterType::Pointer caster = CastImageFilterType::New();
+  typename CastImageFilterType::Pointer caster = CastImageFilterType::New();
   caster->SetInput(filter->GetOutput());
 
   prettyWriter->SetInput(caster->GetOutput());
   prettyWriter->SetFileName(argv[3]);
 
+  profiler.Attach(prettyWriter);
   prettyWriter->Update();
+
+  // Several indices can also be computed in a single pass over the input,
+  // by giving the filter a list of expressions and a VectorImage output
+  // with one band per expression.  Here the NDVI, the NDWI and the SAVI are
+  // computed together; the sub-expressions they have in common, such as
+  // b4-b3 and b4+b3, are evaluated only once per pixel.
+  if (argc == 5) {
+    using IndicesImageType = otb::VectorImage<PixelType, 2>;
+    using IndicesFilterType =
+        otb::VectorBandMathImageFilter<InputImageType, IndicesImageType>;
+    using IndicesWriterType = otb::ImageFileWriter<IndicesImageType>;
+
+    typename IndicesFilterType::Pointer indices = IndicesFilterType::New();
+    indices->SetInput(reader->GetOutput());
+    indices->SetSinglePrecision(std::is_same<TReal, float>::value);
+    indices->SetExpressions({"(b4-b3)/(b4+b3)", "(b2-b4)/(b2+b4)",
+                             "1.5*(b4-b3)/(b4+b3+0.5)"});
+
+    typename IndicesWriterType::Pointer indicesWriter =
+        IndicesWriterType::New();
+    indicesWriter->SetInput(indices->GetOutput());
+    indicesWriter->SetFileName(argv[4]);
+    profiler.Attach(indicesWriter);
+    indicesWriter->Update();
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
+  // Pixel type of the computations (--precision f32|f64, f64 by default)
+  otb::ComputePrecision precision;
+  if (!otb::ParseComputePrecision(argc, argv, precision)) {
+    return EXIT_FAILURE;
+  }
+
+  if (argc != 4 && argc != 5) {
+    std::cerr << "Usage: " << argv[0] << " inputImageFile ";
+    std::cerr << " outputImageFile ";
+    std::cerr << " outputPrettyImageFile [outputIndicesImageFile]";
+    std::cerr << " [--precision f32|f64]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return precision == otb::ComputePrecision::Float32
+             ? Run<float>(argc, argv, profiler)
+             : Run<double>(argc, argv, profiler);
 }
@@ -0,0 +1,345 @@
+//  Frost speckle filter with precomputed distances and tabulated weights.
+//
+//  \doxygen{otb}{FrostImageFilter} computes, at each pixel, the local mean
+//  $E[I]$ and variance $Var[I]$, then averages the window with the weights
+//  $\exp(-\alpha d)$, where $\alpha = D\,Var[I]/E[I]^2$ for the deramp
+//  factor $D$ and $d$ is the distance to the center.  It calls
+//  \code{sqrt} and \code{exp} for every neighbor of every pixel.
+//
+//  This filter computes the same output with much less work:
+//
+//  \begin{itemize}
+//  \item the neighbors are grouped, once per radius, into classes of equal
+//        distance to the center (a $7\times7$ window has 49 neighbors but
+//        only 10 distinct distances).  At each pixel the neighbors are summed
+//        per class, and one weight is evaluated per class instead of one per
+//        neighbor;
+//  \item the weights are read from a table of $\exp(-t)$ with linear
+//        interpolation.  The table is sized from the weight tolerance
+//        $\epsilon$ so that every weight is within $\epsilon$ of the exact
+//        one: the interpolation error of $\exp(-t)$ with a step $h$ is at
+//        most $h^2/8$, so $h = \sqrt{8\epsilon}$, and weights beyond
+//        $t = -\ln\epsilon$ are set to 0.  Since the center weight is
+//        exactly 1, the output then differs from the exact filter by at most
+//        $2\,\epsilon\,n \max|I|$ for a window of $n$ pixels.  The table can
+//        be switched off to evaluate \code{exp} once per class instead;
+//  \item pixels of integer types of up to 16 bits are summed in 64-bit
+//        integers, which is exact, and only converted to floating point for
+//        the final weighting.
+//  \end{itemize}
+//
+//  As in \doxygen{otb}{FrostImageFilter}, pixels outside the image are
+//  replaced by the nearest image pixel and the output is cast (truncated) to
+//  the output pixel type.
+
+#ifndef FastFrostImageFilter_h
+#define FastFrostImageFilter_h
+
+#include "itkImageToImageFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <type_traits>
+#include <vector>
+
+namespace otb {
+
+template <class TInputImage, class TOutputImage>
+class ITK_EXPORT FastFrostImageFilter
+    : public itk::ImageToImageFilter<TInputImage, TOutputImage> {
+public:
+  using Self = FastFrostImageFilter<TInputImage, TOutputImage>;
+  using Superclass = itk::ImageToImageFilter<TInputImage, TOutputImage>;
+  using Pointer = itk::SmartPointer<Self>;
+  using ConstPointer = itk::SmartPointer<const Self>;
+
+  /** Method for creation through object factory */
+  itkNewMacro(Self);
+
+  /** Run-time type information */
+  itkTypeMacro(FastFrostImageFilter, itk::ImageToImageFilter);
+
+  /** Display */
+  void PrintSelf(std::ostream &os, itk::Indent indent) const override;
+
+  using InputPixelType = typename TInputImage::PixelType;
+  using OutputPixelType = typename TOutputImage::PixelType;
+  using OutputImageRegionType = typename TOutputImage::RegionType;
+  using RegionType = typename TInputImage::RegionType;
+  using IndexType = typename TInputImage::IndexType;
+  using SizeType = typename TInputImage::SizeType;
+
+  /** Sums are exact 64-bit integers for integer pixels of up to 16 bits */
+  using AccumulatorType = typename std::conditional<
+      std::is_integral<InputPixelType>::value && sizeof(InputPixelType) <= 2,
+      long long, double>::type;
+
+  itkGetConstReferenceMacro(Radius, SizeType);
+  itkSetMacro(Radius, SizeType);
+
+  /** Deramp factor D of the exponential weights */
+  itkGetMacro(Deramp, double);
+  itkSetMacro(Deramp, double);
+
+  /** Read the weights from a table of exp(-t) (on by default) */
+  itkGetMacro(UseLookupTable, bool);
+  itkSetMacro(UseLookupTable, bool);
+  itkBooleanMacro(UseLookupTable);
+
+  /** Largest error allowed on each tabulated weight */
+  itkGetMacro(WeightTolerance, double);
+  itkSetMacro(WeightTolerance, double);
+
+protected:
+  FastFrostImageFilter();
+  ~FastFrostImageFilter() override = default;
+
+  void GenerateInputRequestedRegion() override;
+  void BeforeThreadedGenerateData() override;
+  void DynamicThreadedGenerateData(
+      const OutputImageRegionType &outputRegion) override;
+
+  /** exp(-t), from the table or exactly */
+  double Weight(double t) const;
+
+private:
+  FastFrostImageFilter(const Self &) = delete;
+  void operator=(const Self &) = delete;
+
+  SizeType m_Radius;
+  double m_Deramp;
+  bool m_UseLookupTable;
+  double m_WeightTolerance;
+
+  // Neighbors of the window and the distance class of each of them
+  std::vector<long> m_OffsetX;
+  std::vector<long> m_OffsetY;
+  std::vector<unsigned int> m_NeighborClass;
+  // Distance to the center and number of neighbors of each class
+  std::vector<double> m_ClassDistance;
+  std::vector<double> m_ClassCount;
+
+  // exp(-t) sampled every m_TableStep up to m_TableLimit
+  std::vector<double> m_Table;
+  double m_TableStep;
+  double m_TableLimit;
+};
+
+} /* namespace otb */
+
+namespace otb {
+
+template <class TInputImage, class TOutputImage>
+FastFrostImageFilter<TInputImage, TOutputImage>::FastFrostImageFilter()
+    : m_Deramp(2.0), m_UseLookupTable(true), m_WeightTolerance(1e-6),
+      m_TableStep(0.0), m_TableLimit(0.0) {
+  m_Radius.Fill(1);
+}
+
+//  The farthest distance class is the window corner, a radius away.
+
+template <class TInputImage, class TOutputImage>
+void FastFrostImageFilter<TInputImage,
+                          TOutputImage>::GenerateInputRequestedRegion() {
+  Superclass::GenerateInputRequestedRegion();
+
+  TInputImage *inputImage = const_cast<TInputImage *>(this->GetInput());
+  if (!inputImage) {
+    return;
+  }
+
+  RegionType inputRequestedRegion = inputImage->GetRequestedRegion();
+  inputRequestedRegion.PadByRadius(m_Radius);
+
+  if (inputRequestedRegion.Crop(inputImage->GetLargestPossibleRegion())) {
+    inputImage->SetRequestedRegion(inputRequestedRegion);
+    return;
+  }
+
+  inputImage->SetRequestedRegion(inputRequestedRegion);
+  itk::InvalidRequestedRegionError e(__FILE__, __LINE__);
+  e.SetLocation(ITK_LOCATION);
+  e.SetDescription("Requested region is (at least partially) outside the "
+                   "largest possible region.");
+  e.SetDataObject(inputImage);
+  throw e;
+}
+
+//  The distance classes and the weight table only depend on the parameters,
+//  so they are built once before the work units start.
+
+template <class TInputImage, class TOutputImage>
+void FastFrostImageFilter<TInputImage,
+                          TOutputImage>::BeforeThreadedGenerateData() {
+  const long rx = m_Radius[0];
+  const long ry = m_Radius[1];
+
+  m_OffsetX.clear();
+  m_OffsetY.clear();
+  m_NeighborClass.clear();
+  m_ClassDistance.clear();
+  m_ClassCount.clear();
+
+  std::map<long, unsigned int> classOfSquaredDistance;
+  for (long y = -ry; y <= ry; ++y) {
+    for (long x = -rx; x <= rx; ++x) {
+      classOfSquaredDistance.emplace(x * x + y * y, 0);
+    }
+  }
+  for (auto &entry : classOfSquaredDistance) {
+    entry.second = m_ClassDistance.size();
+    m_ClassDistance.push_back(std::sqrt(static_cast<double>(entry.first)));
+    m_ClassCount.push_back(0.0);
+  }
+  for (long y = -ry; y <= ry; ++y) {
+    for (long x = -rx; x <= rx; ++x) {
+      const unsigned int k = classOfSquaredDistance[x * x + y * y];
+      m_OffsetX.push_back(x);
+      m_OffsetY.push_back(y);
+      m_NeighborClass.push_back(k);
+      m_ClassCount[k] += 1.0;
+    }
+  }
+
+  m_Table.clear();
+  if (m_UseLookupTable) {
+    if (!(m_WeightTolerance > 0.0 && m_WeightTolerance < 1.0)) {
+      itkExceptionMacro(<< "The weight tolerance must be in ]0, 1[.");
+    }
+    m_TableStep = std::sqrt(8.0 * m_WeightTolerance);
+    m_TableLimit = -std::log(m_WeightTolerance);
+    const size_t size = static_cast<size_t>(m_TableLimit / m_TableStep) + 2;
+    m_Table.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+      m_Table[i] = std::exp(-static_cast<double>(i) * m_TableStep);
+    }
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+double
+FastFrostImageFilter<TInputImage, TOutputImage>::Weight(double t) const {
+  // A negative deramp factor gives weights above 1, which are not tabulated
+  if (!m_UseLookupTable || t < 0.0) {
+    return std::exp(-t);
+  }
+  if (t >= m_TableLimit) {
+    return 0.0;
+  }
+  // The table has one sample beyond the limit, so i + 1 is always valid
+  const double position = t / m_TableStep;
+  const size_t i = static_cast<size_t>(position);
+  const double fraction = position - static_cast<double>(i);
+  return m_Table[i] + fraction * (m_Table[i + 1] - m_Table[i]);
+}
+
+template <class TInputImage, class TOutputImage>
+void FastFrostImageFilter<TInputImage, TOutputImage>::
+    DynamicThreadedGenerateData(const OutputImageRegionType &outputRegion) {
+  const TInputImage *inputImage = this->GetInput();
+  TOutputImage *outputImage = this->GetOutput();
+
+  const RegionType largestRegion = inputImage->GetLargestPossibleRegion();
+  const IndexType bufferIndex = inputImage->GetBufferedRegion().GetIndex();
+  const long bufferStride = inputImage->GetBufferedRegion().GetSize()[0];
+  const InputPixelType *buffer = inputImage->GetBufferPointer();
+
+  const long imageX0 = largestRegion.GetIndex()[0];
+  const long imageY0 = largestRegion.GetIndex()[1];
+  const long imageX1 = imageX0 + largestRegion.GetSize()[0] - 1;
+  const long imageY1 = imageY0 + largestRegion.GetSize()[1] - 1;
+
+  const long rx = m_Radius[0];
+  const long ry = m_Radius[1];
+  const long x0 = outputRegion.GetIndex()[0];
+  const long y0 = outputRegion.GetIndex()[1];
+  const long width = outputRegion.GetSize()[0];
+  const long height = outputRegion.GetSize()[1];
+
+  const size_t neighbors = m_NeighborClass.size();
+  const size_t classes = m_ClassDistance.size();
+  const double size = static_cast<double>(neighbors);
+
+  // Buffer offsets of the neighbors, valid where the window is inside the
+  // image
+  std::vector<long> interiorOffset(neighbors);
+  for (size_t i = 0; i < neighbors; ++i) {
+    interiorOffset[i] = m_OffsetY[i] * bufferStride + m_OffsetX[i];
+  }
+
+  std::vector<AccumulatorType> classSum(classes);
+  std::vector<long> neighborOffset(neighbors);
+
+  const long outputStride = outputImage->GetBufferedRegion().GetSize()[0];
+  OutputPixelType *outputRow =
+      outputImage->GetBufferPointer() +
+      outputImage->ComputeOffset(outputRegion.GetIndex());
+
+  for (long y = y0; y < y0 + height; ++y, outputRow += outputStride) {
+    const bool interiorRow = (y - ry >= imageY0) && (y + ry <= imageY1);
+
+    for (long x = x0; x < x0 + width; ++x) {
+      const long center =
+          (y - bufferIndex[1]) * bufferStride + x - bufferIndex[0];
+      const long *offset = interiorOffset.data();
+      if (!interiorRow || x - rx < imageX0 || x + rx > imageX1) {
+        // Clamp the neighbors onto the image border
+        for (size_t i = 0; i < neighbors; ++i) {
+          const long nx =
+              std::min(std::max(x + m_OffsetX[i], imageX0), imageX1);
+          const long ny =
+              std::min(std::max(y + m_OffsetY[i], imageY0), imageY1);
+          neighborOffset[i] = (ny - bufferIndex[1]) * bufferStride +
+                              nx - bufferIndex[0] - center;
+        }
+        offset = neighborOffset.data();
+      }
+
+      // Moments of the window and sums per distance class
+      const InputPixelType *centerPixel = buffer + center;
+      AccumulatorType sum = 0;
+      AccumulatorType squaredSum = 0;
+      std::fill(classSum.begin(), classSum.end(), AccumulatorType(0));
+      for (size_t i = 0; i < neighbors; ++i) {
+        const AccumulatorType value =
+            static_cast<AccumulatorType>(centerPixel[offset[i]]);
+        sum += value;
+        squaredSum += value * value;
+        classSum[m_NeighborClass[i]] += value;
+      }
+
+      const double mean = static_cast<double>(sum) / size;
+      const double variance =
+          static_cast<double>(squaredSum) / size - mean * mean;
+      const double alpha =
+          (mean == 0.0) ? 0.0 : m_Deramp * variance / (mean * mean);
+
+      double frost = 0.0;
+      double norm = 0.0;
+      for (size_t k = 0; k < classes; ++k) {
+        const double weight = this->Weight(alpha * m_ClassDistance[k]);
+        frost += weight * static_cast<double>(classSum[k]);
+        norm += weight * m_ClassCount[k];
+      }
+
+      const double value = (norm == 0.0) ? 0.0 : frost / norm;
+      outputRow[x - x0] = static_cast<OutputPixelType>(value);
+    }
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+void FastFrostImageFilter<TInputImage, TOutputImage>::PrintSelf(
+    std::ostream &os, itk::Indent indent) const {
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Radius: " << this->m_Radius << std::endl;
+  os << indent << "Deramp: " << this->m_Deramp << std::endl;
+  os << indent << "UseLookupTable: " << this->m_UseLookupTable << std::endl;
+  os << indent << "WeightTolerance: " << this->m_WeightTolerance << std::endl;
+}
+
+} /* end namespace otb */
+
+#endif
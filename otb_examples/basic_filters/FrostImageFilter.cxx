@@ -1,10 +1,13 @@
-#include "otbFrostImageFilter.h"
+#include "FastFrostImageFilter.h"
 
 #include "otbImage.h"
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
 
+#include "PipelineProfiler.h"
+
 int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
 
   if (argc != 5) {
     std::cerr << "Usage: " << argv[0] << " inputImageFile ";
@@ -17,7 +20,11 @@ int main(int argc, char *argv[]) {
   using OutputImageType = otb::Image<PixelType, 2>;
 
   // The filter can be instantiated using the image types defined previously.
-  using FilterType = otb::FrostImageFilter<InputImageType, OutputImageType>;
+  // FastFrostImageFilter applies the same Frost filter as
+  // otb::FrostImageFilter, but evaluates one tabulated weight per distance to
+  // the center instead of one exp() per neighbor, and sums the unsigned char
+  // pixels as integers.
+  using FilterType = otb::FastFrostImageFilter<InputImageType, OutputImageType>;
   using ReaderType = otb::ImageFileReader<InputImageType>;
   using WriterType = otb::ImageFileWriter<OutputImageType>;
 
@@ -29,7 +36,7 @@ int main(int argc, char *argv[]) {
   reader->SetFileName(argv[1]);
 
   // The image obtained with the reader is passed as input to the
-  // FrostImageFilter
+  // FastFrostImageFilter
   filter->SetInput(reader->GetOutput());
 
   // The method SetRadius() defines the size of the window to
@@ -43,5 +50,6 @@ int main(int argc, char *argv[]) {
   filter->SetDeramp(atof(argv[4]));
 
   writer->SetFileName(argv[2]);
+  profiler.Attach(writer);
   writer->Update();
 }
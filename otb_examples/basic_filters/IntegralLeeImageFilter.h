@@ -0,0 +1,280 @@
+//  Lee speckle filter with the local statistics taken from summed-area
+//  tables.
+//
+//  \doxygen{otb}{LeeImageFilter} sums the pixels and their squares over the
+//  whole window at each pixel, so its cost grows with the square of the
+//  radius.  This filter computes the same statistics from two summed-area
+//  tables (integral images), one of the intensity $I$ and one of $I^2$: the
+//  sum over any window is then the combination of four table entries,
+//  whatever the radius.
+//
+//  The output region of each work unit is processed in tiles.  Each tile
+//  builds its own tables over the tile padded by the radius, so the tables
+//  stay small, the values they accumulate stay small (which limits the
+//  rounding error on the variance), and the filter streams and threads like
+//  any other.  Pixels outside the image are replaced by the nearest image
+//  pixel, which is the zero-flux Neumann condition used by
+//  \doxygen{otb}{LeeImageFilter}.
+//
+//  With $E[I]$ and $Var[I]$ the local mean and variance, $C_u^2 = 1/L$ for
+//  $L$ looks and $C_I^2 = Var[I]/E[I]^2$, the output is $E[I]$ where
+//  $C_I^2 < C_u^2$, and $E[I] + w\,(I - E[I])$ with $w = 1 - C_u^2/C_I^2$
+//  elsewhere.
+
+#ifndef IntegralLeeImageFilter_h
+#define IntegralLeeImageFilter_h
+
+#include "itkImageToImageFilter.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace otb {
+
+template <class TInputImage, class TOutputImage>
+class ITK_EXPORT IntegralLeeImageFilter
+    : public itk::ImageToImageFilter<TInputImage, TOutputImage> {
+public:
+  using Self = IntegralLeeImageFilter<TInputImage, TOutputImage>;
+  using Superclass = itk::ImageToImageFilter<TInputImage, TOutputImage>;
+  using Pointer = itk::SmartPointer<Self>;
+  using ConstPointer = itk::SmartPointer<const Self>;
+
+  /** Method for creation through object factory */
+  itkNewMacro(Self);
+
+  /** Run-time type information */
+  itkTypeMacro(IntegralLeeImageFilter, itk::ImageToImageFilter);
+
+  /** Display */
+  void PrintSelf(std::ostream &os, itk::Indent indent) const override;
+
+  using InputPixelType = typename TInputImage::PixelType;
+  using OutputPixelType = typename TOutputImage::PixelType;
+  using OutputImageRegionType = typename TOutputImage::RegionType;
+  using RegionType = typename TInputImage::RegionType;
+  using IndexType = typename TInputImage::IndexType;
+  using SizeType = typename TInputImage::SizeType;
+
+  itkGetConstReferenceMacro(Radius, SizeType);
+  itkSetMacro(Radius, SizeType);
+
+  /** Number of looks of the input image */
+  itkGetMacro(NbLooks, double);
+  itkSetMacro(NbLooks, double);
+
+  /** Size of the tiles, each with its own summed-area tables */
+  itkGetConstReferenceMacro(TileSize, SizeType);
+  itkSetMacro(TileSize, SizeType);
+
+protected:
+  IntegralLeeImageFilter();
+  ~IntegralLeeImageFilter() override = default;
+
+  void GenerateInputRequestedRegion() override;
+  void DynamicThreadedGenerateData(
+      const OutputImageRegionType &outputRegion) override;
+
+  /** Filter one tile of the output region */
+  void GenerateTile(const OutputImageRegionType &tile,
+                    std::vector<double> &sumTable,
+                    std::vector<double> &squaredSumTable);
+
+private:
+  IntegralLeeImageFilter(const Self &) = delete;
+  void operator=(const Self &) = delete;
+
+  SizeType m_Radius;
+  double m_NbLooks;
+  SizeType m_TileSize;
+};
+
+} /* namespace otb */
+
+namespace otb {
+
+template <class TInputImage, class TOutputImage>
+IntegralLeeImageFilter<TInputImage, TOutputImage>::IntegralLeeImageFilter()
+    : m_NbLooks(1.0) {
+  m_Radius.Fill(1);
+  m_TileSize.Fill(256);
+}
+
+//  The summed-area tables of a tile cover it padded by the radius.
+
+template <class TInputImage, class TOutputImage>
+void IntegralLeeImageFilter<TInputImage,
+                            TOutputImage>::GenerateInputRequestedRegion() {
+  Superclass::GenerateInputRequestedRegion();
+
+  TInputImage *inputImage = const_cast<TInputImage *>(this->GetInput());
+  if (!inputImage) {
+    return;
+  }
+
+  RegionType inputRequestedRegion = inputImage->GetRequestedRegion();
+  inputRequestedRegion.PadByRadius(m_Radius);
+
+  if (inputRequestedRegion.Crop(inputImage->GetLargestPossibleRegion())) {
+    inputImage->SetRequestedRegion(inputRequestedRegion);
+    return;
+  }
+
+  inputImage->SetRequestedRegion(inputRequestedRegion);
+  itk::InvalidRequestedRegionError e(__FILE__, __LINE__);
+  e.SetLocation(ITK_LOCATION);
+  e.SetDescription("Requested region is (at least partially) outside the "
+                   "largest possible region.");
+  e.SetDataObject(inputImage);
+  throw e;
+}
+
+template <class TInputImage, class TOutputImage>
+void IntegralLeeImageFilter<TInputImage, TOutputImage>::
+    DynamicThreadedGenerateData(const OutputImageRegionType &outputRegion) {
+  // The tables are reused from one tile to the next
+  std::vector<double> sumTable;
+  std::vector<double> squaredSumTable;
+
+  const IndexType start = outputRegion.GetIndex();
+  const long width = outputRegion.GetSize()[0];
+  const long height = outputRegion.GetSize()[1];
+  const long tileWidth = std::max<long>(m_TileSize[0], 1);
+  const long tileHeight = std::max<long>(m_TileSize[1], 1);
+
+  for (long ty = 0; ty < height; ty += tileHeight) {
+    for (long tx = 0; tx < width; tx += tileWidth) {
+      OutputImageRegionType tile = outputRegion;
+      IndexType tileIndex = start;
+      tileIndex[0] += tx;
+      tileIndex[1] += ty;
+      SizeType tileSize = outputRegion.GetSize();
+      tileSize[0] = std::min(tileWidth, width - tx);
+      tileSize[1] = std::min(tileHeight, height - ty);
+      tile.SetIndex(tileIndex);
+      tile.SetSize(tileSize);
+
+      this->GenerateTile(tile, sumTable, squaredSumTable);
+    }
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+void IntegralLeeImageFilter<TInputImage, TOutputImage>::GenerateTile(
+    const OutputImageRegionType &tile, std::vector<double> &sumTable,
+    std::vector<double> &squaredSumTable) {
+  const TInputImage *inputImage = this->GetInput();
+  TOutputImage *outputImage = this->GetOutput();
+
+  const RegionType largestRegion = inputImage->GetLargestPossibleRegion();
+  const IndexType bufferIndex = inputImage->GetBufferedRegion().GetIndex();
+  const long bufferStride = inputImage->GetBufferedRegion().GetSize()[0];
+  const InputPixelType *buffer = inputImage->GetBufferPointer();
+
+  const long imageX0 = largestRegion.GetIndex()[0];
+  const long imageY0 = largestRegion.GetIndex()[1];
+  const long imageX1 = imageX0 + largestRegion.GetSize()[0] - 1;
+  const long imageY1 = imageY0 + largestRegion.GetSize()[1] - 1;
+
+  const long rx = m_Radius[0];
+  const long ry = m_Radius[1];
+  const long x0 = tile.GetIndex()[0];
+  const long y0 = tile.GetIndex()[1];
+  const long width = tile.GetSize()[0];
+  const long height = tile.GetSize()[1];
+
+  // The tables cover the tile padded by the radius, with out-of-image
+  // pixels clamped onto the image border.  table[(j + 1) * stride + i + 1]
+  // holds the sum over the padded columns 0 .. i and rows 0 .. j; the
+  // leading row and column of zeros avoid border tests.
+  const long columns = width + 2 * rx;
+  const long rows = height + 2 * ry;
+  const long stride = columns + 1;
+
+  std::vector<long> columnOffset(columns);
+  for (long c = 0; c < columns; ++c) {
+    const long x = std::min(std::max(x0 - rx + c, imageX0), imageX1);
+    columnOffset[c] = x - bufferIndex[0];
+  }
+
+  sumTable.assign(stride * (rows + 1), 0.0);
+  squaredSumTable.assign(stride * (rows + 1), 0.0);
+
+  for (long j = 0; j < rows; ++j) {
+    const long y = std::min(std::max(y0 - ry + j, imageY0), imageY1);
+    const InputPixelType *row = buffer + (y - bufferIndex[1]) * bufferStride;
+
+    const double *sumAbove = &sumTable[j * stride + 1];
+    const double *squaredSumAbove = &squaredSumTable[j * stride + 1];
+    double *sumCurrent = &sumTable[(j + 1) * stride + 1];
+    double *squaredSumCurrent = &squaredSumTable[(j + 1) * stride + 1];
+
+    double rowSum = 0.0;
+    double rowSquaredSum = 0.0;
+    for (long c = 0; c < columns; ++c) {
+      const double value = static_cast<double>(row[columnOffset[c]]);
+      rowSum += value;
+      rowSquaredSum += value * value;
+      sumCurrent[c] = sumAbove[c] + rowSum;
+      squaredSumCurrent[c] = squaredSumAbove[c] + rowSquaredSum;
+    }
+  }
+
+  const double count = static_cast<double>((2 * rx + 1) * (2 * ry + 1));
+  const double cu2 = 1.0 / m_NbLooks;
+
+  const long outputStride = outputImage->GetBufferedRegion().GetSize()[0];
+  OutputPixelType *outputRow = outputImage->GetBufferPointer() +
+                               outputImage->ComputeOffset(tile.GetIndex());
+
+  for (long y = 0; y < height; ++y, outputRow += outputStride) {
+    // In padded coordinates the window of output row y spans the table rows
+    // y .. y + 2 ry, and the window of column x the columns x .. x + 2 rx
+    const long top = y * stride;
+    const long bottom = (y + 2 * ry + 1) * stride;
+    const InputPixelType *inputRow =
+        buffer + (y0 + y - bufferIndex[1]) * bufferStride;
+
+    for (long x = 0; x < width; ++x) {
+      const long left = x;
+      const long right = x + 2 * rx + 1;
+
+      const double sum = sumTable[bottom + right] - sumTable[bottom + left] -
+                         sumTable[top + right] + sumTable[top + left];
+      const double squaredSum =
+          squaredSumTable[bottom + right] - squaredSumTable[bottom + left] -
+          squaredSumTable[top + right] + squaredSumTable[top + left];
+
+      const double mean = sum / count;
+      const double variance = std::max(squaredSum / count - mean * mean, 0.0);
+      const double intensity =
+          static_cast<double>(inputRow[x0 + x - bufferIndex[0]]);
+
+      // A zero mean carries no speckle information; keep it rather than
+      // dividing by zero
+      double value = mean;
+      if (mean != 0.0) {
+        const double ci2 = variance / (mean * mean);
+        if (ci2 >= cu2) {
+          const double w = 1.0 - cu2 / ci2;
+          value = intensity * w + mean * (1.0 - w);
+        }
+      }
+      outputRow[x] = static_cast<OutputPixelType>(value);
+    }
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+void IntegralLeeImageFilter<TInputImage, TOutputImage>::PrintSelf(
+    std::ostream &os, itk::Indent indent) const {
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Radius: " << this->m_Radius << std::endl;
+  os << indent << "NbLooks: " << this->m_NbLooks << std::endl;
+  os << indent << "TileSize: " << this->m_TileSize << std::endl;
+}
+
+} /* end namespace otb */
+
+#endif
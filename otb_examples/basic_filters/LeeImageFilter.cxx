@@ -1,24 +1,28 @@
-#include "otbLeeImageFilter.h"
+#include "IntegralLeeImageFilter.h"
 
 #include "otbImage.h"
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
 
-int main(int argc, char *argv[]) {
-  if (argc != 5) {
-    std::cerr << "Usage: " << argv[0] << " inputImageFile ";
-    std::cerr << " outputImageFile radius NbLooks" << std::endl;
-    return EXIT_FAILURE;
-  }
+#include "ComputePrecision.h"
+#include "PipelineProfiler.h"
 
-  using PixelType = double;
+// The example, for images of TReal pixels (float or double)
+template <class TReal>
+int Run(char *argv[], otb::PipelineProfiler &profiler) {
+  using PixelType = TReal;
 
   // The images are defined using the pixel type and the dimension.
   using InputImageType = otb::Image<PixelType, 2>;
   using OutputImageType = otb::Image<PixelType, 2>;
 
   // The filter can be instantiated using the image types defined above.
-  using FilterType = otb::LeeImageFilter<InputImageType, OutputImageType>;
+  // IntegralLeeImageFilter applies the same Lee filter as
+  // otb::LeeImageFilter, but takes the local mean and variance from
+  // summed-area tables built per tile, so its cost does not grow with the
+  // radius.  The tables accumulate in double whatever the pixel type.
+  using FilterType =
+      otb::IntegralLeeImageFilter<InputImageType, OutputImageType>;
 
   // An ImageFileReader class is also instantiated in order to read
   // image data from a file.
@@ -30,22 +34,22 @@ int main(int argc, char *argv[]) {
 
   // Both the filter and the reader are created by invoking their New()
   // methods and assigning the result to SmartPointers.
-  ReaderType::Pointer reader = ReaderType::New();
-  FilterType::Pointer filter = FilterType::New();
+  typename ReaderType::Pointer reader = ReaderType::New();
+  typename FilterType::Pointer filter = FilterType::New();
 
-  WriterType::Pointer writer = WriterType::New();
+  typename WriterType::Pointer writer = WriterType::New();
   writer->SetInput(filter->GetOutput());
   reader->SetFileName(argv[1]);
 
   // The image obtained with the reader is passed as input to the
-  // LeeImageFilter.
+  // IntegralLeeImageFilter.
   filter->SetInput(reader->GetOutput());
 
   // The method SetRadius() defines the size of the window to
   // be used for the computation of the local statistics. The method
   // SetNbLooks() sets the number of looks of the input
   // image.
-  FilterType::SizeType Radius;
+  typename FilterType::SizeType Radius;
   Radius[0] = atoi(argv[3]);
   Radius[1] = atoi(argv[3]);
 
@@ -53,5 +57,29 @@ int main(int argc, char *argv[]) {
   filter->SetNbLooks(atoi(argv[4]));
 
   writer->SetFileName(argv[2]);
+  profiler.Attach(writer);
   writer->Update();
+
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
+  // Pixel type of the computations (--precision f32|f64, f64 by default)
+  otb::ComputePrecision precision;
+  if (!otb::ParseComputePrecision(argc, argv, precision)) {
+    return EXIT_FAILURE;
+  }
+
+  if (argc != 5) {
+    std::cerr << "Usage: " << argv[0] << " inputImageFile ";
+    std::cerr << " outputImageFile radius NbLooks [--precision f32|f64]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return precision == otb::ComputePrecision::Float32
+             ? Run<float>(argv, profiler)
+             : Run<double>(argv, profiler);
 }
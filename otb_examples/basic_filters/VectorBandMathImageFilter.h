@@ -0,0 +1,285 @@
+//  Band math evaluated directly on a multi-band \doxygen{otb}{VectorImage}.
+//
+//  \doxygen{otb}{BandMathImageFilter} takes one scalar image per band, so a
+//  multispectral image has to be split first with
+//  \doxygen{otb}{VectorImageToImageListFilter}, which copies every band out
+//  of the interleaved pixel buffer.  This filter instead reads the bands of
+//  each pixel in place from the input buffer and binds them to the variables
+//  \code{b1} .. \code{bN} of the expression, so no band image is ever
+//  allocated.
+//
+//  The expression is compiled once by \code{BandMathExpression} into a
+//  program evaluated on blocks of pixels, rather than interpreted for every
+//  pixel.  Expressions using muParser features the compiler does not handle
+//  are evaluated with \doxygen{otb}{Parser} instead (muParser with the OTB
+//  extensions); each work unit then owns its own parser, since a parser
+//  evaluates from the variables it is bound to.
+//
+//  Several expressions can be given at once.  They are then evaluated in a
+//  single pass over the input, sharing their common sub-expressions, and
+//  the output must be a \doxygen{otb}{VectorImage} with one band per
+//  expression.
+//
+//  The compiled expressions are evaluated in \code{double} unless
+//  \code{SinglePrecision} is set.  Evaluating them in \code{float} is faster
+//  but does not only round the results: a comparison or an \code{if} on
+//  values computed in \code{float} can take the other branch near its
+//  threshold, so a thresholded pixel may flip, e.g. from 255 to 0.
+
+#ifndef VectorBandMathImageFilter_h
+#define VectorBandMathImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "otbParser.h"
+
+#include "BandMathExpression.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace otb {
+
+template <class TInputImage, class TOutputImage>
+class ITK_EXPORT VectorBandMathImageFilter
+    : public itk::ImageToImageFilter<TInputImage, TOutputImage> {
+public:
+  using Self = VectorBandMathImageFilter<TInputImage, TOutputImage>;
+  using Superclass = itk::ImageToImageFilter<TInputImage, TOutputImage>;
+  using Pointer = itk::SmartPointer<Self>;
+  using ConstPointer = itk::SmartPointer<const Self>;
+
+  /** Method for creation through object factory */
+  itkNewMacro(Self);
+
+  /** Run-time type information */
+  itkTypeMacro(VectorBandMathImageFilter, itk::ImageToImageFilter);
+
+  /** Display */
+  void PrintSelf(std::ostream &os, itk::Indent indent) const override;
+
+  using InputInternalPixelType = typename TInputImage::InternalPixelType;
+  using OutputInternalPixelType = typename TOutputImage::InternalPixelType;
+  using OutputImageRegionType = typename TOutputImage::RegionType;
+  using ParserType = otb::Parser;
+  using ValueType = ParserType::ValueType;
+
+  /** Expression evaluated at each pixel, using b1 .. bN for the bands */
+  void SetExpression(const std::string &expression) {
+    this->SetExpressions(std::vector<std::string>(1, expression));
+  }
+  std::string GetExpression() const {
+    return m_Expressions.empty() ? std::string() : m_Expressions.front();
+  }
+
+  /** Expressions evaluated at each pixel, one per output band */
+  void SetExpressions(const std::vector<std::string> &expressions) {
+    if (m_Expressions != expressions) {
+      m_Expressions = expressions;
+      this->Modified();
+    }
+  }
+  itkGetConstReferenceMacro(Expressions, std::vector<std::string>);
+
+  /** Evaluate the compiled expressions in float rather than double (off by
+   * default); thresholds may then select differently */
+  itkGetMacro(SinglePrecision, bool);
+  itkSetMacro(SinglePrecision, bool);
+  itkBooleanMacro(SinglePrecision);
+
+protected:
+  VectorBandMathImageFilter()
+      : m_SinglePrecision(false), m_UseCompiledExpression(true) {}
+  ~VectorBandMathImageFilter() override = default;
+
+  void GenerateOutputInformation() override;
+  void BeforeThreadedGenerateData() override;
+  void DynamicThreadedGenerateData(
+      const OutputImageRegionType &outputRegion) override;
+
+private:
+  VectorBandMathImageFilter(const Self &) = delete;
+  void operator=(const Self &) = delete;
+
+  /** Create a parser for an expression, bound to the given band values */
+  ParserType::Pointer CreateParser(const std::string &expression,
+                                   std::vector<ValueType> &bandValues) const;
+
+  /** Evaluate the compiled expressions in TReal on the rows of a region */
+  template <class TReal>
+  void EvaluateCompiled(const InputInternalPixelType *inputRow,
+                        long inputStride, OutputInternalPixelType *outputRow,
+                        long outputStride, long width, long height) const;
+
+  std::vector<std::string> m_Expressions;
+  bool m_SinglePrecision;
+
+  /** Expression compiled for the current input, when supported */
+  BandMathExpression m_CompiledExpression;
+  bool m_UseCompiledExpression;
+};
+
+} /* namespace otb */
+
+namespace otb {
+
+template <class TInputImage, class TOutputImage>
+void VectorBandMathImageFilter<TInputImage,
+                               TOutputImage>::GenerateOutputInformation() {
+  Superclass::GenerateOutputInformation();
+
+  this->GetOutput()->SetNumberOfComponentsPerPixel(m_Expressions.size());
+}
+
+template <class TInputImage, class TOutputImage>
+typename VectorBandMathImageFilter<TInputImage, TOutputImage>::ParserType::
+    Pointer
+    VectorBandMathImageFilter<TInputImage, TOutputImage>::CreateParser(
+        const std::string &expression,
+        std::vector<ValueType> &bandValues) const {
+  ParserType::Pointer parser = ParserType::New();
+  for (unsigned int band = 0; band < bandValues.size(); ++band) {
+    std::ostringstream name;
+    name << "b" << band + 1;
+    parser->DefineVar(name.str(), &bandValues[band]);
+  }
+  parser->SetExpr(expression);
+  return parser;
+}
+
+//  The expression is compiled (or, failing that, evaluated once by the
+//  parser) before the work units start, so a syntax error or an unknown
+//  variable is reported once, from the calling thread.
+
+template <class TInputImage, class TOutputImage>
+void VectorBandMathImageFilter<TInputImage,
+                               TOutputImage>::BeforeThreadedGenerateData() {
+  if (m_Expressions.empty()) {
+    itkExceptionMacro(<< "No expression set.");
+  }
+  if (this->GetOutput()->GetNumberOfComponentsPerPixel() !=
+      m_Expressions.size()) {
+    itkExceptionMacro(<< m_Expressions.size()
+                      << " expressions set but the output image has "
+                      << this->GetOutput()->GetNumberOfComponentsPerPixel()
+                      << " band(s).");
+  }
+
+  const unsigned int nbBands =
+      this->GetInput()->GetNumberOfComponentsPerPixel();
+  try {
+    m_CompiledExpression.Compile(m_Expressions, nbBands);
+    m_UseCompiledExpression = true;
+  } catch (itk::ExceptionObject &err) {
+    itkDebugMacro(<< "Falling back to the parser: " << err.GetDescription());
+    m_UseCompiledExpression = false;
+
+    std::vector<ValueType> bandValues(nbBands, 0.0);
+    for (const std::string &expression : m_Expressions) {
+      ParserType::Pointer parser = this->CreateParser(expression, bandValues);
+      parser->Eval();
+    }
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+void VectorBandMathImageFilter<TInputImage, TOutputImage>::
+    DynamicThreadedGenerateData(const OutputImageRegionType &outputRegion) {
+  const TInputImage *inputImage = this->GetInput();
+  TOutputImage *outputImage = this->GetOutput();
+
+  const unsigned int nbBands = inputImage->GetNumberOfComponentsPerPixel();
+  const unsigned int nbOutputs = m_Expressions.size();
+
+  // Rows of the region are contiguous in both buffers, the input holding
+  // nbBands interleaved values per pixel and the output nbOutputs
+  const long width = outputRegion.GetSize()[0];
+  const long height = outputRegion.GetSize()[1];
+  const long inputStride =
+      inputImage->GetBufferedRegion().GetSize()[0] * nbBands;
+  const long outputStride =
+      outputImage->GetBufferedRegion().GetSize()[0] * nbOutputs;
+
+  const InputInternalPixelType *inputRow =
+      inputImage->GetBufferPointer() +
+      inputImage->ComputeOffset(outputRegion.GetIndex()) * nbBands;
+  OutputInternalPixelType *outputRow =
+      outputImage->GetBufferPointer() +
+      outputImage->ComputeOffset(outputRegion.GetIndex()) * nbOutputs;
+
+  if (m_UseCompiledExpression) {
+    if (m_SinglePrecision) {
+      this->template EvaluateCompiled<float>(inputRow, inputStride, outputRow,
+                                             outputStride, width, height);
+    } else {
+      this->template EvaluateCompiled<double>(
+          inputRow, inputStride, outputRow, outputStride, width, height);
+    }
+    return;
+  }
+
+  std::vector<ValueType> bandValues(nbBands, 0.0);
+  std::vector<ParserType::Pointer> parsers;
+  for (const std::string &expression : m_Expressions) {
+    parsers.push_back(this->CreateParser(expression, bandValues));
+  }
+
+  for (long y = 0; y < height;
+       ++y, inputRow += inputStride, outputRow += outputStride) {
+    const InputInternalPixelType *pixel = inputRow;
+    OutputInternalPixelType *output = outputRow;
+    for (long x = 0; x < width; ++x, pixel += nbBands) {
+      for (unsigned int band = 0; band < nbBands; ++band) {
+        bandValues[band] = static_cast<ValueType>(pixel[band]);
+      }
+      for (unsigned int k = 0; k < nbOutputs; ++k, ++output) {
+        *output = static_cast<OutputInternalPixelType>(parsers[k]->Eval());
+      }
+    }
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+template <class TReal>
+void VectorBandMathImageFilter<TInputImage, TOutputImage>::EvaluateCompiled(
+    const InputInternalPixelType *inputRow, long inputStride,
+    OutputInternalPixelType *outputRow, long outputStride, long width,
+    long height) const {
+  const unsigned int nbBands =
+      this->GetInput()->GetNumberOfComponentsPerPixel();
+  const unsigned int nbOutputs = m_Expressions.size();
+
+  BandMathExpression::Workspace<TReal> workspace;
+  m_CompiledExpression.InitializeWorkspace(workspace);
+  std::vector<TReal> result(BandMathExpression::BlockSize * nbOutputs);
+
+  for (long y = 0; y < height;
+       ++y, inputRow += inputStride, outputRow += outputStride) {
+    for (long x = 0; x < width; x += BandMathExpression::BlockSize) {
+      const unsigned int count = static_cast<unsigned int>(
+          std::min<long>(BandMathExpression::BlockSize, width - x));
+      m_CompiledExpression.Evaluate(inputRow + x * nbBands, count,
+                                    result.data(), workspace);
+      OutputInternalPixelType *output = outputRow + x * nbOutputs;
+      for (unsigned int i = 0; i < count * nbOutputs; ++i) {
+        output[i] = static_cast<OutputInternalPixelType>(result[i]);
+      }
+    }
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+void VectorBandMathImageFilter<TInputImage, TOutputImage>::PrintSelf(
+    std::ostream &os, itk::Indent indent) const {
+  Superclass::PrintSelf(os, indent);
+
+  for (const std::string &expression : m_Expressions) {
+    os << indent << "Expression: " << expression << std::endl;
+  }
+  os << indent << "SinglePrecision: " << m_SinglePrecision << std::endl;
+}
+
+} /* end namespace otb */
+
+#endif
@@ -18,6 +18,8 @@
 #include "itkNumericTraits.h"
 #include "otbImage.h"
 
+#include "StreamingRescaleIntensityImageFilter.h"
+
 //  Now we can declare the filter itself.  It is within the OTB namespace,
 //  and we decide to make it use the same image type for both input and
 //  output, thus the template declaration needs only one parameter.
@@ -57,6 +59,14 @@ public:
   itkGetMacro(Threshold, PixelType);
   itkSetMacro(Threshold, PixelType);
 
+  /** In fused mode the rescaling bounds come from a first streamed pass
+   * over the thresholded gradient, and each requested region is then
+   * computed and rescaled on its own, so no full-size intermediate image is
+   * held and the filter can be streamed. Off by default. */
+  itkGetMacro(FusedMode, bool);
+  itkSetMacro(FusedMode, bool);
+  itkBooleanMacro(FusedMode);
+
 protected:
   CompositeExampleImageFilter();
 
@@ -68,6 +78,8 @@ protected:
   using GradientType =
       itk::GradientMagnitudeImageFilter<TImageType, TImageType>;
   using RescalerType = itk::RescaleIntensityImageFilter<TImageType, TImageType>;
+  using StreamingRescalerType =
+      otb::StreamingRescaleIntensityImageFilter<TImageType, TImageType>;
 
   void GenerateData() override;
 
@@ -81,8 +93,10 @@ private:
   typename GradientType::Pointer m_GradientFilter;
   typename ThresholdType::Pointer m_ThresholdFilter;
   typename RescalerType::Pointer m_RescaleFilter;
+  typename StreamingRescalerType::Pointer m_StreamingRescaleFilter;
 
   PixelType m_Threshold;
+  bool m_FusedMode;
 };
 
 } /* namespace otb */
@@ -97,15 +111,22 @@ CompositeExampleImageFilter<TImageType>::CompositeExampleImageFilter() {
   m_GradientFilter = GradientType::New();
   m_ThresholdFilter = ThresholdType::New();
   m_RescaleFilter = RescalerType::New();
+  m_StreamingRescaleFilter = StreamingRescalerType::New();
 
   m_ThresholdFilter->SetInput(m_GradientFilter->GetOutput());
   m_RescaleFilter->SetInput(m_ThresholdFilter->GetOutput());
+  m_StreamingRescaleFilter->SetInput(m_ThresholdFilter->GetOutput());
 
   m_Threshold = 1;
+  m_FusedMode = false;
 
   m_RescaleFilter->SetOutputMinimum(
       itk::NumericTraits<PixelType>::NonpositiveMin());
   m_RescaleFilter->SetOutputMaximum(itk::NumericTraits<PixelType>::max());
+  m_StreamingRescaleFilter->SetOutputMinimum(
+      itk::NumericTraits<PixelType>::NonpositiveMin());
+  m_StreamingRescaleFilter->SetOutputMaximum(
+      itk::NumericTraits<PixelType>::max());
 }
 
 //  The \code{GenerateData()} is where the composite magic happens.  First,
@@ -116,6 +137,16 @@ CompositeExampleImageFilter<TImageType>::CompositeExampleImageFilter() {
 //  pipeline to be processed by calling \code{Update()} on the final stage,
 //  then graft the output back onto the output of the enclosing filter, so
 //  it has the result available to the downstream filter.
+//
+//  The rescaling filter needs the global minimum and maximum of its input,
+//  so it forces the whole thresholded gradient to be computed and held in
+//  memory.  In fused mode the composite avoids that with a
+//  \code{StreamingRescaleIntensityImageFilter}: a first pass streams the
+//  gradient and threshold stages through
+//  \doxygen{otb}{StreamingMinMaxImageFilter}, keeping only the bounds, and
+//  every requested region is then computed again and mapped linearly to the
+//  output range.  No full-size intermediate image is held, and the composite
+//  can be streamed.
 
 template <class TImageType>
 void CompositeExampleImageFilter<TImageType>::GenerateData() {
@@ -123,9 +154,18 @@ void CompositeExampleImageFilter<TImageType>::GenerateData() {
 
   m_ThresholdFilter->ThresholdBelow(this->m_Threshold);
 
-  m_RescaleFilter->GraftOutput(this->GetOutput());
-  m_RescaleFilter->Update();
-  this->GraftOutput(m_RescaleFilter->GetOutput());
+  if (!m_FusedMode) {
+    m_RescaleFilter->GraftOutput(this->GetOutput());
+    m_RescaleFilter->Update();
+    this->GraftOutput(m_RescaleFilter->GetOutput());
+    return;
+  }
+
+  // The streaming rescaler runs its min/max pass over the thresholded
+  // gradient once, then computes and rescales the requested region only
+  m_StreamingRescaleFilter->GraftOutput(this->GetOutput());
+  m_StreamingRescaleFilter->Update();
+  this->GraftOutput(m_StreamingRescaleFilter->GetOutput());
 }
 
 //  Finally we define the \code{PrintSelf} method, which (by convention)
@@ -138,6 +178,7 @@ void CompositeExampleImageFilter<TImageType>::PrintSelf(
   Superclass::PrintSelf(os, indent);
 
   os << indent << "Threshold:" << this->m_Threshold << std::endl;
+  os << indent << "FusedMode:" << this->m_FusedMode << std::endl;
 }
 
 } /* end namespace otb */
@@ -152,10 +193,15 @@ void CompositeExampleImageFilter<TImageType>::PrintSelf(
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
 
+#include "PipelineProfiler.h"
+
 int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
   if (argc < 3) {
     std::cerr << "Usage: " << std::endl;
-    std::cerr << argv[0] << "  inputImageFile  outputImageFile" << std::endl;
+    std::cerr << argv[0] << "  inputImageFile  outputImageFile  [fused]"
+              << std::endl;
     return EXIT_FAILURE;
   }
 
@@ -172,10 +218,12 @@ int main(int argc, char *argv[]) {
   reader->SetFileName(argv[1]);
   filter->SetInput(reader->GetOutput());
   filter->SetThreshold(20);
+  filter->SetFusedMode(argc > 3 && std::string(argv[3]) == "fused");
   writer->SetInput(filter->GetOutput());
   writer->SetFileName(argv[2]);
 
   try {
+    profiler.Attach(writer);
     writer->Update();
   } catch (itk::ExceptionObject &e) {
     std::cerr << "Error: " << e << std::endl;
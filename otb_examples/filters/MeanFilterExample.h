@@ -0,0 +1,265 @@
+//  The composite filter we will build combines three filters: a gradient
+//  magnitude operator, which will calculate the first-order derivative of
+//  the image; a thresholding step to select edges over a given strength;
+//  and finally a rescaling filter, to ensure the resulting image data is
+//  visible by scaling the intensity to the full spectrum of the output
+//  image type.
+//
+//  Since this filter takes an image and produces another image (of
+//  identical type), we will specialize the ImageToImageFilter:
+
+#ifndef MeanFilterExample_h
+#define MeanFilterExample_h
+
+//  Next we include headers for the component filters:
+#include "itkConstNeighborhoodIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkNeighborhoodAlgorithm.h"
+#include "itkImageToImageFilter.h"
+
+#include "itkNumericTraits.h"
+#include "otbImage.h"
+
+//  Now we can declare the filter itself.  It is within the OTB namespace,
+//  and we decide to make it use the same image type for both input and
+//  output, thus the template declaration needs only one parameter.
+//  Deriving from \code{ImageToImageFilter} provides default behavior for
+//  several important aspects, notably allocating the output image (and
+//  making it the same dimensions as the input).
+
+namespace otb {
+
+template <class TImageType>
+class ITK_EXPORT MeanFilterExample
+    : public itk::ImageToImageFilter<TImageType, TImageType> {
+public:
+  //  Next we have the standard declarations, used for object creation with
+  //  the object factory:
+
+  using Self = MeanFilterExample<TImageType>;
+  using Superclass = itk::ImageToImageFilter<TImageType, TImageType>;
+  using Pointer = itk::SmartPointer<Self>;
+  using ConstPointer = itk::SmartPointer<const Self>;
+
+  /** Method for creation through object factory */
+  itkNewMacro(Self);
+
+  /** Run-time type information */
+  itkTypeMacro(MeanFilterExample, itk::ImageToImageFilter);
+
+  /** Display */
+  void PrintSelf(std::ostream &os, itk::Indent indent) const override;
+
+  using PixelType = typename TImageType::PixelType;
+
+  itkGetMacro(Radius, unsigned int);
+  itkSetMacro(Radius, unsigned int);
+
+protected:
+  MeanFilterExample();
+  ~MeanFilterExample() override = default;
+
+  //  Now we can declare the component filter types, templated over the
+  //  enclosing image type:
+
+protected:
+  void GenerateData() override;
+
+  // Mean over the interior face with a radius known at compile time.
+  // Returns false when m_Radius has no specialized kernel.
+  bool GenerateInteriorData(const typename TImageType::RegionType &region);
+
+  template <unsigned int VRadius>
+  void GenerateInteriorDataWithRadius(
+      const typename TImageType::RegionType &region);
+
+private:
+  // As stated in documentation, we need to ensure that the filter is created
+  // only by means of the factory methods
+  MeanFilterExample(const Self &) = delete; // prevent copying operator
+  void operator=(const Self &) = delete;    // prevent assignment operator
+
+  // We declare the radius of the kernel (neighborhooditerators radius)
+  unsigned int m_Radius;
+};
+
+} /* namespace otb */
+
+//  The constructor sets up the pipeline, which involves creating the
+//  stages, connecting them together, and setting default parameters.
+
+namespace otb {
+
+template <class TImageType> MeanFilterExample<TImageType>::MeanFilterExample() {
+  m_Radius = 1;
+}
+
+//  The \code{GenerateData()} is where the composite magic happens.  First,
+//  we connect the first component filter to the inputs of the composite
+//  filter (the actual input, supplied by the upstream stage).  Then we
+//  graft the output of the last stage onto the output of the composite,
+//  which ensures the filter regions are updated.  We force the composite
+//  pipeline to be processed by calling \code{Update()} on the final stage,
+//  then graft the output back onto the output of the enclosing filter, so
+//  it has the result available to the downstream filter.
+
+template <class TImageType> void MeanFilterExample<TImageType>::GenerateData() {
+  // Get input/output filter
+  typename TImageType::ConstPointer inputImage = this->GetInput();
+  typename TImageType::Pointer outputImage = this->GetOutput();
+
+  outputImage->SetRegions(inputImage->GetLargestPossibleRegion());
+  outputImage->SetRequestedRegion(inputImage->GetRequestedRegion());
+  outputImage->Allocate();
+
+  // Declare input/output iterators types
+  using NeighborhoodIteratorType = itk::ConstNeighborhoodIterator<TImageType>;
+  using OutputIteratorType = itk::ImageRegionIterator<TImageType>;
+
+  // Declare and use radius type (assign private member m_Radius)
+  typename NeighborhoodIteratorType::RadiusType radius;
+  radius.Fill(m_Radius);
+
+  // Main iterator code
+  this->GetOutput()->SetRequestedRegion(this->GetInput()->GetRequestedRegion());
+  this->GetOutput()->Allocate();
+
+  // The requested region is split into an interior face, where the whole
+  // neighborhood lies inside the image, and boundary faces.  For the common
+  // radii the interior face is computed by a kernel with a fixed window
+  // size; everything else goes through the neighborhood iterator.
+  using FaceCalculatorType =
+      itk::NeighborhoodAlgorithm::ImageBoundaryFacesCalculator<TImageType>;
+  FaceCalculatorType faceCalculator;
+  typename FaceCalculatorType::FaceListType faceList =
+      faceCalculator(inputImage, inputImage->GetRequestedRegion(), radius);
+
+  for (auto fit = faceList.begin(); fit != faceList.end(); ++fit) {
+    if (fit == faceList.begin() && this->GenerateInteriorData(*fit)) {
+      continue;
+    }
+
+    // Declare input/output iterators referencing input/output channels
+    NeighborhoodIteratorType inputIterator(radius, inputImage, *fit);
+    OutputIteratorType outputIterator(outputImage, *fit);
+
+    for (inputIterator.GoToBegin(), outputIterator.GoToBegin();
+         !inputIterator.IsAtEnd(); ++inputIterator, ++outputIterator) {
+      float sum = 0.0;
+      unsigned int count = 0;
+
+      for (unsigned int i = 0; i < inputIterator.Size(); ++i) {
+        if (inputIterator.GetPixel(i) != itk::NumericTraits<PixelType>::Zero) {
+          sum += inputIterator.GetPixel(i);
+          ++count;
+        }
+      }
+
+      PixelType meanValue =
+          static_cast<PixelType>((count > 0) ? (sum / count) : 0.0);
+      outputIterator.Set(meanValue);
+    }
+  }
+}
+
+//  Most runs use radius 3, and a handful of small radii cover nearly all the
+//  others.  For those the window size is a template parameter, so the loops
+//  over the window have a fixed trip count and the column offsets are
+//  constants, which lets the compiler unroll and vectorize them.  The
+//  specialized kernels only handle 2D images.
+
+template <class TImageType>
+bool MeanFilterExample<TImageType>::GenerateInteriorData(
+    const typename TImageType::RegionType &region) {
+  if (TImageType::ImageDimension != 2) {
+    return false;
+  }
+
+  switch (m_Radius) {
+  case 1:
+    this->GenerateInteriorDataWithRadius<1>(region);
+    return true;
+  case 2:
+    this->GenerateInteriorDataWithRadius<2>(region);
+    return true;
+  case 3:
+    this->GenerateInteriorDataWithRadius<3>(region);
+    return true;
+  case 5:
+    this->GenerateInteriorDataWithRadius<5>(region);
+    return true;
+  case 7:
+    this->GenerateInteriorDataWithRadius<7>(region);
+    return true;
+  default:
+    return false;
+  }
+}
+
+//  The window is visited in the same order as the neighborhood iterator
+//  (row by row, left to right), and the zero test selects the value rather
+//  than branching, so the sums are the same as on the generic path.
+
+template <class TImageType>
+template <unsigned int VRadius>
+void MeanFilterExample<TImageType>::GenerateInteriorDataWithRadius(
+    const typename TImageType::RegionType &region) {
+  constexpr int Radius = static_cast<int>(VRadius);
+
+  const TImageType *inputImage = this->GetInput();
+  TImageType *outputImage = this->GetOutput();
+
+  const long inputStride = inputImage->GetBufferedRegion().GetSize()[0];
+  const long outputStride = outputImage->GetBufferedRegion().GetSize()[0];
+  const long width = region.GetSize()[0];
+  const long height = region.GetSize()[1];
+
+  const PixelType *inputRow = inputImage->GetBufferPointer() +
+                              inputImage->ComputeOffset(region.GetIndex());
+  PixelType *outputRow = outputImage->GetBufferPointer() +
+                         outputImage->ComputeOffset(region.GetIndex());
+
+  for (long y = 0; y < height;
+       ++y, inputRow += inputStride, outputRow += outputStride) {
+    for (long x = 0; x < width; ++x) {
+      const PixelType *center = inputRow + x;
+      float sum = 0.0;
+      unsigned int count = 0;
+
+      for (int dy = -Radius; dy <= Radius; ++dy) {
+        const PixelType *row = center + dy * inputStride;
+        for (int dx = -Radius; dx <= Radius; ++dx) {
+          const PixelType value = row[dx];
+          const bool valid = value != itk::NumericTraits<PixelType>::Zero;
+          sum += valid ? static_cast<float>(value) : 0.0f;
+          count += valid;
+        }
+      }
+
+      outputRow[x] = static_cast<PixelType>((count > 0) ? (sum / count) : 0.0);
+    }
+  }
+}
+
+//  Finally we define the \code{PrintSelf} method, which (by convention)
+//  prints the filter parameters.  Note how it invokes the superclass to
+//  print itself first, and also how the indentation prefixes each line.
+//
+template <class TImageType>
+void MeanFilterExample<TImageType>::PrintSelf(std::ostream &os,
+                                              itk::Indent indent) const {
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Radius:" << this->m_Radius << std::endl;
+}
+
+} /* end namespace otb */
+
+//  It is important to note that in the above example, none of the internal
+//  details of the pipeline were exposed to users of the class.  The interface
+//  consisted of the Threshold parameter (which happened to change the value in
+//  the component filter) and the regular ImageToImageFilter interface.  This
+//  example pipeline is illustrated in
+//  Figure~\ref{fig:CompositeExamplePipeline}.
+
+#endif
@@ -0,0 +1,254 @@
+//  Local mean, variance and count of valid pixels over a square window,
+//  where pixels equal to zero are treated as no-data and ignored.
+//
+//  Instead of visiting every pixel of the (2r+1)x(2r+1) window at each
+//  position (twice, once for the mean and once for the deviations), the
+//  filter keeps running sums of the value, the squared value and the number
+//  of valid pixels.  Each work unit keeps one set of column sums covering the
+//  window height; moving down one row adds the entering row and removes the
+//  leaving one, and moving right along a row adds the entering column and
+//  removes the leaving one.  The cost per pixel is therefore constant,
+//  whatever the radius.
+//
+//  Pixels outside the image are replaced by the nearest image pixel, which
+//  is the zero-flux Neumann boundary condition used by default by
+//  \doxygen{itk}{ConstNeighborhoodIterator}.
+//
+//  The output is a three-band vector image: band 0 holds the mean, band 1
+//  the (population) variance and band 2 the number of valid pixels.
+
+#ifndef MaskedLocalStatisticsImageFilter_h
+#define MaskedLocalStatisticsImageFilter_h
+
+#include "itkImageRegionIterator.h"
+#include "itkImageToImageFilter.h"
+#include "itkNumericTraits.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace otb {
+
+template <class TInputImage, class TOutputImage>
+class ITK_EXPORT MaskedLocalStatisticsImageFilter
+    : public itk::ImageToImageFilter<TInputImage, TOutputImage> {
+public:
+  using Self = MaskedLocalStatisticsImageFilter<TInputImage, TOutputImage>;
+  using Superclass = itk::ImageToImageFilter<TInputImage, TOutputImage>;
+  using Pointer = itk::SmartPointer<Self>;
+  using ConstPointer = itk::SmartPointer<const Self>;
+
+  /** Method for creation through object factory */
+  itkNewMacro(Self);
+
+  /** Run-time type information */
+  itkTypeMacro(MaskedLocalStatisticsImageFilter, itk::ImageToImageFilter);
+
+  /** Display */
+  void PrintSelf(std::ostream &os, itk::Indent indent) const override;
+
+  using InputPixelType = typename TInputImage::PixelType;
+  using OutputPixelType = typename TOutputImage::PixelType;
+  using OutputImageRegionType = typename TOutputImage::RegionType;
+  using RegionType = typename TInputImage::RegionType;
+  using IndexType = typename TInputImage::IndexType;
+  using SizeType = typename TInputImage::SizeType;
+
+  /** Output band holding each statistic */
+  static constexpr unsigned int MeanBand = 0;
+  static constexpr unsigned int VarianceBand = 1;
+  static constexpr unsigned int CountBand = 2;
+
+  itkGetConstReferenceMacro(Radius, SizeType);
+  itkSetMacro(Radius, SizeType);
+
+  /** Set the same radius along every dimension */
+  void SetRadius(unsigned int radius) {
+    SizeType size;
+    size.Fill(radius);
+    this->SetRadius(size);
+  }
+
+protected:
+  MaskedLocalStatisticsImageFilter();
+  ~MaskedLocalStatisticsImageFilter() override = default;
+
+  void GenerateOutputInformation() override;
+  void GenerateInputRequestedRegion() override;
+  void DynamicThreadedGenerateData(
+      const OutputImageRegionType &outputRegion) override;
+
+private:
+  MaskedLocalStatisticsImageFilter(const Self &) = delete;
+  void operator=(const Self &) = delete;
+
+  SizeType m_Radius;
+};
+
+} /* namespace otb */
+
+namespace otb {
+
+template <class TInputImage, class TOutputImage>
+MaskedLocalStatisticsImageFilter<
+    TInputImage, TOutputImage>::MaskedLocalStatisticsImageFilter() {
+  m_Radius.Fill(1);
+}
+
+template <class TInputImage, class TOutputImage>
+void MaskedLocalStatisticsImageFilter<
+    TInputImage, TOutputImage>::GenerateOutputInformation() {
+  Superclass::GenerateOutputInformation();
+
+  this->GetOutput()->SetNumberOfComponentsPerPixel(3);
+}
+
+//  The running column sums start a radius above and to the left of the
+//  region, so the input is padded by the radius.
+
+template <class TInputImage, class TOutputImage>
+void MaskedLocalStatisticsImageFilter<
+    TInputImage, TOutputImage>::GenerateInputRequestedRegion() {
+  Superclass::GenerateInputRequestedRegion();
+
+  TInputImage *inputImage = const_cast<TInputImage *>(this->GetInput());
+  if (!inputImage) {
+    return;
+  }
+
+  RegionType inputRequestedRegion = inputImage->GetRequestedRegion();
+  inputRequestedRegion.PadByRadius(m_Radius);
+
+  if (inputRequestedRegion.Crop(inputImage->GetLargestPossibleRegion())) {
+    inputImage->SetRequestedRegion(inputRequestedRegion);
+    return;
+  }
+
+  inputImage->SetRequestedRegion(inputRequestedRegion);
+  itk::InvalidRequestedRegionError e(__FILE__, __LINE__);
+  e.SetLocation(ITK_LOCATION);
+  e.SetDescription("Requested region is (at least partially) outside the "
+                   "largest possible region.");
+  e.SetDataObject(inputImage);
+  throw e;
+}
+
+template <class TInputImage, class TOutputImage>
+void MaskedLocalStatisticsImageFilter<TInputImage, TOutputImage>::
+    DynamicThreadedGenerateData(const OutputImageRegionType &outputRegion) {
+  const TInputImage *inputImage = this->GetInput();
+  TOutputImage *outputImage = this->GetOutput();
+
+  const RegionType largestRegion = inputImage->GetLargestPossibleRegion();
+  const IndexType bufferIndex = inputImage->GetBufferedRegion().GetIndex();
+  const long bufferStride = inputImage->GetBufferedRegion().GetSize()[0];
+  const InputPixelType *buffer = inputImage->GetBufferPointer();
+
+  const long imageX0 = largestRegion.GetIndex()[0];
+  const long imageY0 = largestRegion.GetIndex()[1];
+  const long imageX1 = imageX0 + largestRegion.GetSize()[0] - 1;
+  const long imageY1 = imageY0 + largestRegion.GetSize()[1] - 1;
+
+  const long rx = m_Radius[0];
+  const long ry = m_Radius[1];
+  const long x0 = outputRegion.GetIndex()[0];
+  const long y0 = outputRegion.GetIndex()[1];
+  const long width = outputRegion.GetSize()[0];
+  const long height = outputRegion.GetSize()[1];
+
+  // Columns x0 - rx .. x0 + width - 1 + rx, mapped to buffer offsets with
+  // the out-of-image columns clamped onto the image border
+  const long columns = width + 2 * rx;
+  std::vector<long> columnOffset(columns);
+  for (long c = 0; c < columns; ++c) {
+    const long x = std::min(std::max(x0 - rx + c, imageX0), imageX1);
+    columnOffset[c] = x - bufferIndex[0];
+  }
+
+  auto rowPointer = [&](long y) {
+    y = std::min(std::max(y, imageY0), imageY1);
+    return buffer + (y - bufferIndex[1]) * bufferStride;
+  };
+
+  // Running column sums over the rows y - ry .. y + ry
+  std::vector<double> columnSum(columns, 0.0);
+  std::vector<double> columnSquaredSum(columns, 0.0);
+  std::vector<long> columnCount(columns, 0);
+
+  for (long y = y0 - ry; y <= y0 + ry; ++y) {
+    const InputPixelType *row = rowPointer(y);
+    for (long c = 0; c < columns; ++c) {
+      const double value = static_cast<double>(row[columnOffset[c]]);
+      columnSum[c] += value;
+      columnSquaredSum[c] += value * value;
+      columnCount[c] += (value != 0.0);
+    }
+  }
+
+  const long windowWidth = 2 * rx + 1;
+  OutputPixelType pixel(3);
+  itk::ImageRegionIterator<TOutputImage> outputIt(outputImage, outputRegion);
+  outputIt.GoToBegin();
+
+  for (long y = y0; y < y0 + height; ++y) {
+    double sum = 0.0;
+    double squaredSum = 0.0;
+    long count = 0;
+    for (long c = 0; c < windowWidth; ++c) {
+      sum += columnSum[c];
+      squaredSum += columnSquaredSum[c];
+      count += columnCount[c];
+    }
+
+    for (long x = 0; x < width; ++x, ++outputIt) {
+      if (x > 0) {
+        // Slide the window one column to the right
+        const long entering = x + windowWidth - 1;
+        const long leaving = x - 1;
+        sum += columnSum[entering] - columnSum[leaving];
+        squaredSum += columnSquaredSum[entering] - columnSquaredSum[leaving];
+        count += columnCount[entering] - columnCount[leaving];
+      }
+
+      double mean = 0.0;
+      double variance = 0.0;
+      if (count > 0) {
+        mean = sum / count;
+        variance = std::max(squaredSum / count - mean * mean, 0.0);
+      }
+
+      pixel[MeanBand] = static_cast<typename OutputPixelType::ValueType>(mean);
+      pixel[VarianceBand] =
+          static_cast<typename OutputPixelType::ValueType>(variance);
+      pixel[CountBand] =
+          static_cast<typename OutputPixelType::ValueType>(count);
+      outputIt.Set(pixel);
+    }
+
+    if (y + 1 < y0 + height) {
+      // Slide the column sums one row down
+      const InputPixelType *enteringRow = rowPointer(y + ry + 1);
+      const InputPixelType *leavingRow = rowPointer(y - ry);
+      for (long c = 0; c < columns; ++c) {
+        const double entering =
+            static_cast<double>(enteringRow[columnOffset[c]]);
+        const double leaving = static_cast<double>(leavingRow[columnOffset[c]]);
+        columnSum[c] += entering - leaving;
+        columnSquaredSum[c] += entering * entering - leaving * leaving;
+        columnCount[c] += (entering != 0.0) - (leaving != 0.0);
+      }
+    }
+  }
+}
+
+template <class TInputImage, class TOutputImage>
+void MaskedLocalStatisticsImageFilter<TInputImage, TOutputImage>::PrintSelf(
+    std::ostream &os, itk::Indent indent) const {
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Radius: " << this->m_Radius << std::endl;
+}
+
+} /* end namespace otb */
+
+#endif
@@ -21,7 +21,11 @@
 #include "itkConstNeighborhoodIterator.h"
 #include "itkImageRegionIterator.h"
 
+#include "PipelineProfiler.h"
+
 int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
   if (argc < 3) {
     std::cerr << "Missing parameters. " << std::endl;
     std::cerr << "Usage: " << std::endl;
@@ -55,6 +59,7 @@ int main(int argc, char *argv[]) {
   ReaderType::Pointer reader = ReaderType::New();
   reader->SetFileName(argv[1]);
   try {
+    profiler.Attach(reader);
     reader->Update();
   } catch (itk::ExceptionObject &err) {
     std::cout << "ExceptionObject caught !" << std::endl;
@@ -110,6 +115,7 @@ int main(int argc, char *argv[]) {
   writer->SetFileName(argv[2]);
   writer->SetInput(output);
   try {
+    profiler.Attach(writer);
     writer->Update();
   } catch (itk::ExceptionObject &err) {
     std::cout << "ExceptionObject caught !" << std::endl;
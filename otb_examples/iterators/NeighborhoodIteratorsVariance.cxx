@@ -12,16 +12,18 @@
 // computations to the output image.  A const version of the neighborhood
 // iterator is used because the input image is read-only.
 
-#include "itkRescaleIntensityImageFilter.h"
-#include "itkUnaryFunctorImageFilter.h"
 #include "otbImage.h"
 #include "otbImageFileReader.h"
 #include "otbImageFileWriter.h"
+#include "otbVectorImage.h"
 
-#include "itkConstNeighborhoodIterator.h"
-#include "itkImageRegionIterator.h"
+#include "MaskedLocalStatisticsImageFilter.h"
+
+#include "PipelineProfiler.h"
 
 int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
   if (argc < 3) {
     std::cerr << "Missing parameters. " << std::endl;
     std::cerr << "Usage: " << std::endl;
@@ -29,96 +31,45 @@ int main(int argc, char *argv[]) {
     return -1;
   }
 
-  // The finite difference calculations
+  // The statistics calculations
   // in this algorithm require floating point values.  Hence, we define the
   // image pixel type to be \code{float} and the file reader will automatically
   // cast fixed-point data to \code{float}.
-  //
-  // We declare the iterator types using the image type as
-  // the template parameter. The second template parameter of the
-  // neighborhood iterator, which specifies
-  // the boundary condition, has been omitted because the default condition is
-  // appropriate for this algorithm.
 
   using PixelType = float;
   using ImageType = otb::Image<PixelType, 2>;
   using ReaderType = otb::ImageFileReader<ImageType>;
 
-  using NeighborhoodIteratorType = itk::ConstNeighborhoodIterator<ImageType>;
-  using IteratorType = itk::ImageRegionIterator<ImageType>;
-
-  // The following code creates and executes the OTB image reader.
-  // The \code{Update}
-  // call on the reader object is surrounded by the standard \code{try/catch}
-  // blocks to handle any exceptions that may be thrown by the reader.
-
   ReaderType::Pointer reader = ReaderType::New();
   reader->SetFileName(argv[1]);
-  try {
-    reader->Update();
-  } catch (itk::ExceptionObject &err) {
-    std::cout << "ExceptionObject caught !" << std::endl;
-    std::cout << err << std::endl;
-    return -1;
-  }
 
-  //  We can now create a neighborhood iterator to range over the output of the
-  //  reader. For Sobel edge-detection in 2D, we need a square iterator that
-  //  extends one pixel away from the neighborhood center in every dimension.
-
-  NeighborhoodIteratorType::RadiusType radius;
-  radius.Fill(3);
-  NeighborhoodIteratorType it(radius, reader->GetOutput(),
-                              reader->GetOutput()->GetRequestedRegion());
-
-  // The following code creates an output image and iterator.
-
-  ImageType::Pointer output = ImageType::New();
-  output->SetRegions(reader->GetOutput()->GetRequestedRegion());
-  output->Allocate();
-
-  IteratorType out(output, reader->GetOutput()->GetRequestedRegion());
-
-  for (it.GoToBegin(), out.GoToBegin(); !it.IsAtEnd(); ++it, ++out) {
-    float mean = 0.0;
-    float sum = 0.0;
-    unsigned int count = 0;
-
-    // Iterate through the neighborhood to calculate the mean
-    for (unsigned int i = 0; i < it.Size(); ++i) {
-      if (it.GetPixel(i) != itk::NumericTraits<PixelType>::Zero) {
-        sum += it.GetPixel(i);
-        ++count;
-      }
-    }
-    mean = (count > 0) ? sum / count : 0.0;
-    // Iterate through the neighborhood to calculate the standard deviation
-    sum = 0;
-    count = 0;
-    for (unsigned int i = 0; i < it.Size(); ++i) {
-      if (it.GetPixel(i) != itk::NumericTraits<PixelType>::Zero) {
-        float aux = it.GetPixel(i) - mean;
-        sum += aux * aux;
-        ++count;
-      }
-    }
-    float std = (count > 0) ? sum / count : 0.0;
-    out.Set(std);
-  }
+  //  The local statistics over a $7\times7$ window are computed by
+  //  \code{MaskedLocalStatisticsImageFilter}.  As in the two-pass
+  //  neighborhood loop, pixels equal to zero are treated as no-data and left
+  //  out of the mean, the variance and the count.  The filter updates running
+  //  sums as the window slides, so the cost per pixel does not grow with the
+  //  radius, and it produces the three statistics in a single pass.
+
+  using StatisticsImageType = otb::VectorImage<PixelType, 2>;
+  using StatisticsFilterType =
+      otb::MaskedLocalStatisticsImageFilter<ImageType, StatisticsImageType>;
+
+  StatisticsFilterType::Pointer statistics = StatisticsFilterType::New();
+  statistics->SetRadius(3);
+  statistics->SetInput(reader->GetOutput());
 
-  // The last step is to write the output buffer to an image file.  Writing is
+  // The last step is to write the output to an image file.  Writing is
   // done inside a \code{try/catch} block to handle any exceptions.  The output
-  // is rescaled to intensity range $[0, 255]$ and cast to unsigned char so that
-  // it can be saved and visualized as a PNG image.
+  // holds the mean, the variance and the number of valid pixels as three
+  // bands, and is streamed so the whole image never needs to fit in memory.
 
-  using WritePixelType = float;
-  using WriteImageType = otb::Image<WritePixelType, 2>;
-  using WriterType = otb::ImageFileWriter<WriteImageType>;
+  using WriterType = otb::ImageFileWriter<StatisticsImageType>;
 
   WriterType::Pointer writer = WriterType::New();
   writer->SetFileName(argv[2]);
-  writer->SetInput(output);
+  writer->SetInput(statistics->GetOutput());
   try {
+    profiler.Attach(writer);
     writer->Update();
   } catch (itk::ExceptionObject &err) {
     std::cout << "ExceptionObject caught !" << std::endl;
@@ -3,14 +3,23 @@
 #include "otbWrapperApplication.h"
 #include "otbWrapperApplicationFactory.h"
 
-class SARVarianceFilter : public otb::Wrapper::Application {
+namespace otb {
+namespace Wrapper {
+
+class SARVarianceFilter : public Application {
 public:
   typedef SARVarianceFilter Self;
-  typedef otb::Wrapper::Application Superclass;
+  typedef Application Superclass;
   typedef itk::SmartPointer<Self> Pointer;
   itkNewMacro(Self);
 
 private:
+  // Define image type
+  typedef otb::Image<float, 2> ImageType;
+
+  // Define the variance filter
+  typedef itk::VarianceImageFilter<ImageType, ImageType> VarianceFilterType;
+
   void DoInit() override {
     // Application name and description
     SetName("SARVarianceFilter");
@@ -29,37 +38,45 @@ private:
     AddParameter(ParameterType_Int, "radius", "Filter Radius");
     SetParameterDescription("radius", "Radius of the variance filter kernel.");
     SetDefaultParameterInt("radius", 3);
+    SetMinimumParameterIntValue("radius", 1);
+
+    // Available RAM, used by the output writer to size the streamed tiles
+    AddRAMParameter();
 
     // Set roles
     SetParameterRole("in", Role_Input);
     SetParameterRole("out", Role_Output);
   }
 
-  void DoExecute() override {
-    // Define image type
-    typedef otb::Image<float, 2> ImageType;
+  void DoUpdateParameters() override {}
 
-    // Read input image
-    auto inputImage = GetParameterImage("in");
+  void DoExecute() override {
+    // Read input image (first band, as float)
+    ImageType::Pointer inputImage = GetParameterFloatImage("in");
 
-    // Define the variance filter
-    typedef itk::VarianceImageFilter<ImageType, ImageType> VarianceFilterType;
-    auto varianceFilter = VarianceFilterType::New();
+    m_VarianceFilter = VarianceFilterType::New();
 
     // Set the input image
-    varianceFilter->SetInput(inputImage);
+    m_VarianceFilter->SetInput(inputImage);
 
     // Set the radius
     VarianceFilterType::InputSizeType radius;
     radius.Fill(GetParameterInt("radius"));
-    varianceFilter->SetRadius(radius);
+    m_VarianceFilter->SetRadius(radius);
 
-    // Run the filter
-    varianceFilter->Update();
+    // The pipeline is not updated here: the output writer streams it tile
+    // by tile, with tiles sized from the ram parameter, and the progress of
+    // the filter is reported for each tile.
+    AddProcess(m_VarianceFilter, "Computing local variance");
 
     // Set the output image
-    SetParameterOutputImage("out", varianceFilter->GetOutput());
+    SetParameterOutputImage("out", m_VarianceFilter->GetOutput());
   }
+
+  // The filter must outlive DoExecute() since the writer runs it afterwards
+  VarianceFilterType::Pointer m_VarianceFilter;
 };
+} // namespace Wrapper
+} // namespace otb
 
-OTB_APPLICATION_EXPORT(SARVarianceFilter)
+OTB_APPLICATION_EXPORT(otb::Wrapper::SARVarianceFilter)
@@ -3,7 +3,11 @@
 #include "otbImageFileWriter.h"
 #include "otbLocalStatisticExtractionFilter.h"
 
+#include "PipelineProfiler.h"
+
 int main(int argc, char *argv[]) {
+  otb::PipelineProfiler profiler(argc, argv);
+
   typedef otb::Image<float, 2> ImageType;
 
   if (argc < 4) {
@@ -30,6 +34,7 @@ int main(int argc, char *argv[]) {
   writer->SetFileName(outputFileName);
   writer->SetInput(varianceFilter->GetOutput());
 
+  profiler.Attach(writer);
   writer->Update();
 
   return EXIT_SUCCESS;